@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// An allocator for std::vector that aligns the storage, for SIMD loads and to keep rows from straddling cache lines
+template <typename T, size_t ALIGNMENT = 64>
+struct AlignedAllocator
+{
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, ALIGNMENT> other;
+    };
+
+    AlignedAllocator() {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) {}
+
+    T* allocate(size_t count)
+    {
+#ifdef _MSC_VER
+        void* ret = _aligned_malloc(count * sizeof(T), ALIGNMENT);
+#else
+        void* ret = nullptr;
+        if (posix_memalign(&ret, ALIGNMENT, count * sizeof(T)) != 0)
+            ret = nullptr;
+#endif
+        if (!ret)
+            throw std::bad_alloc();
+        return (T*)ret;
+    }
+
+    void deallocate(T* ptr, size_t)
+    {
+#ifdef _MSC_VER
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+    }
+
+    template <typename U>
+    bool operator == (const AlignedAllocator<U, ALIGNMENT>&) const { return true; }
+
+    template <typename U>
+    bool operator != (const AlignedAllocator<U, ALIGNMENT>&) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
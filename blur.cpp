@@ -1,6 +1,9 @@
 #include "blur.h"
 
+#include <algorithm>
+
 const float     c_blurThresholdPercent = 0.005f; // lower numbers give higher quality results, but take longer. This is 0.5%
+const float     c_recursiveBlurWarmUpSigmas = 8.0f; // how many sigmas of wrapped around pixels the recursive blur runs over before writing results
 
 static inline int PixelsNeededForSigma(float sigma)
 {
@@ -42,7 +45,7 @@ static inline std::vector<float> GaussianKernelIntegrals(float sigma, int taps)
     return ret;
 }
 
-static inline const float* GetPixelWrapAround(const std::vector<float>& image, size_t width, int x, int y)
+static inline const float* GetPixelWrapAround(const std::vector<float>& image, size_t width, size_t height, int x, int y)
 {
     if (x >= (int)width)
     {
@@ -54,28 +57,28 @@ static inline const float* GetPixelWrapAround(const std::vector<float>& image, s
             x += (int)width;
     }
 
-    if (y >= (int)width)
+    if (y >= (int)height)
     {
-        y = y % (int)width;
+        y = y % (int)height;
     }
     else
     {
         while (y < 0)
-            y += (int)width;
+            y += (int)height;
     }
 
     return &image[(y * width) + x];
 }
 
-void GaussianBlur(const std::vector<float>& srcImage, std::vector<float> &destImage, size_t width, float blurSigma)
+void GaussianBlur(const std::vector<float>& srcImage, std::vector<float> &destImage, size_t width, size_t height, float blurSigma)
 {
     int blurSize = PixelsNeededForSigma(blurSigma);
 
     // allocate space for copying the image for destImage and tmpImage
-    destImage.resize(width*width, 0.0f);
+    destImage.resize(width*height, 0.0f);
 
     std::vector<float> tmpImage;
-    tmpImage.resize(width*width, 0.0f);
+    tmpImage.resize(width*height, 0.0f);
 
     // horizontal blur from srcImage into tmpImage
     {
@@ -83,14 +86,14 @@ void GaussianBlur(const std::vector<float>& srcImage, std::vector<float> &destIm
 
         int startOffset = -1 * int(row.size() / 2);
 
-        for (int y = 0; y < width; ++y)
+        for (int y = 0; y < height; ++y)
         {
             for (int x = 0; x < width; ++x)
             {
                 float blurredPixel = 0.0f;
                 for (unsigned int i = 0; i < row.size(); ++i)
                 {
-                    const float *pixel = GetPixelWrapAround(srcImage, width, x + startOffset + i, y);
+                    const float *pixel = GetPixelWrapAround(srcImage, width, height, x + startOffset + i, y);
                     blurredPixel += pixel[0] * row[i];
                 }
 
@@ -106,14 +109,14 @@ void GaussianBlur(const std::vector<float>& srcImage, std::vector<float> &destIm
 
         int startOffset = -1 * int(row.size() / 2);
 
-        for (int y = 0; y < width; ++y)
+        for (int y = 0; y < height; ++y)
         {
             for (int x = 0; x < width; ++x)
             {
                 float blurredPixel = 0.0f;
                 for (unsigned int i = 0; i < row.size(); ++i)
                 {
-                    const float *pixel = GetPixelWrapAround(tmpImage, width, x, y + startOffset + i);
+                    const float *pixel = GetPixelWrapAround(tmpImage, width, height, x, y + startOffset + i);
                     blurredPixel += pixel[0] * row[i];
                 }
 
@@ -122,4 +125,106 @@ void GaussianBlur(const std::vector<float>& srcImage, std::vector<float> &destIm
             }
         }
     }
-}
\ No newline at end of file
+}
+
+// Young / van Vliet recursive gaussian coefficients.
+// "Recursive implementation of the Gaussian filter" 1995, https://doi.org/10.1016/0165-1684(95)00020-E
+struct RecursiveGaussianCoefficients
+{
+    float B;
+    float b1;
+    float b2;
+    float b3;
+};
+
+static RecursiveGaussianCoefficients MakeRecursiveGaussianCoefficients(float sigma)
+{
+    float q = (sigma >= 2.5f)
+        ? 0.98711f * sigma - 0.96330f
+        : 3.97156f - 4.14554f * sqrtf(1.0f - 0.26891f * sigma);
+
+    float q2 = q * q;
+    float q3 = q2 * q;
+
+    float b0 = 1.57825f + 2.44413f * q + 1.4281f * q2 + 0.422205f * q3;
+
+    RecursiveGaussianCoefficients ret;
+    ret.b1 = (2.44413f * q + 2.85619f * q2 + 1.26661f * q3) / b0;
+    ret.b2 = -(1.4281f * q2 + 1.26661f * q3) / b0;
+    ret.b3 = (0.422205f * q3) / b0;
+    ret.B = 1.0f - (ret.b1 + ret.b2 + ret.b3);
+    return ret;
+}
+
+// Filters "count" values that are "stride" apart, treating them as periodic so the result tiles.
+// The causal and anti causal filters are warmed up by running them over the wrapped around values first,
+// so the cost is constant per pixel no matter what sigma is (at most double when warmUp is the whole line).
+static void RecursiveGaussian1D(const float* src, float* dest, int count, int stride, int warmUp, const RecursiveGaussianCoefficients& c)
+{
+    // causal filter, left to right, writing into dest
+    {
+        int start = count - warmUp;
+        float w1 = src[(start % count) * stride];
+        float w2 = w1;
+        float w3 = w1;
+        for (int i = start; i < count + count; ++i)
+        {
+            int index = i % count;
+            float w0 = c.B * src[index * stride] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = w0;
+            if (i >= count)
+                dest[index * stride] = w0;
+        }
+    }
+
+    // anti causal filter, right to left, in place in dest
+    {
+        float y1 = dest[((warmUp - 1) % count) * stride];
+        float y2 = y1;
+        float y3 = y1;
+        for (int i = warmUp - 1; i > -count; --i)
+        {
+            int index = (i + count) % count;
+            float y0 = c.B * dest[index * stride] + c.b1 * y1 + c.b2 * y2 + c.b3 * y3;
+            y3 = y2;
+            y2 = y1;
+            y1 = y0;
+            if (i <= 0)
+                dest[index * stride] = y0;
+        }
+    }
+}
+
+void GaussianBlurRecursive(const std::vector<float>& srcImage, std::vector<float> &destImage, size_t width, size_t height, float blurSigma)
+{
+    // the coefficients are only valid for sigma >= 0.5
+    if (blurSigma < 0.5f)
+    {
+        GaussianBlur(srcImage, destImage, width, height, blurSigma);
+        return;
+    }
+
+    RecursiveGaussianCoefficients coefficients = MakeRecursiveGaussianCoefficients(blurSigma);
+
+    // how far the filters need to run over wrapped around pixels before their state has converged. Each axis wraps at its own size.
+    int warmUpPixels = int(ceil(c_recursiveBlurWarmUpSigmas * blurSigma)) + 3;
+    int warmUpX = std::min(int(width), warmUpPixels);
+    int warmUpY = std::min(int(height), warmUpPixels);
+
+    destImage.resize(width*height, 0.0f);
+
+    std::vector<float> tmpImage;
+    tmpImage.resize(width*height, 0.0f);
+
+    // horizontal blur from srcImage into tmpImage
+    #pragma omp parallel for
+    for (int y = 0; y < int(height); ++y)
+        RecursiveGaussian1D(&srcImage[y*width], &tmpImage[y*width], int(width), 1, warmUpX, coefficients);
+
+    // vertical blur from tmpImage into destImage
+    #pragma omp parallel for
+    for (int x = 0; x < int(width); ++x)
+        RecursiveGaussian1D(&tmpImage[x], &destImage[x], int(height), int(width), warmUpY, coefficients);
+}
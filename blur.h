@@ -2,4 +2,19 @@
 
 #include <vector>
 
-void GaussianBlur(const std::vector<float>& srcImage, std::vector<float> &destImage, size_t width, float blurSigma);
+// The blurs wrap around on both axes, so the result tiles.
+void GaussianBlur(const std::vector<float>& srcImage, std::vector<float> &destImage, size_t width, size_t height, float blurSigma);
+
+inline void GaussianBlur(const std::vector<float>& srcImage, std::vector<float> &destImage, size_t width, float blurSigma)
+{
+    GaussianBlur(srcImage, destImage, width, width, blurSigma);
+}
+
+// Same as GaussianBlur, but uses a recursive (IIR) approximation of the gaussian so the cost per pixel doesn't depend on sigma.
+// Less accurate than GaussianBlur for small sigmas, much faster for large ones.
+void GaussianBlurRecursive(const std::vector<float>& srcImage, std::vector<float> &destImage, size_t width, size_t height, float blurSigma);
+
+inline void GaussianBlurRecursive(const std::vector<float>& srcImage, std::vector<float> &destImage, size_t width, float blurSigma)
+{
+    GaussianBlurRecursive(srcImage, destImage, width, width, blurSigma);
+}
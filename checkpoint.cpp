@@ -0,0 +1,212 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "checkpoint.h"
+#include "misc.h"
+#include "settings.h"
+
+#include <sstream>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+static const char c_checkpointMagic[4] = { 'B', 'N', 'C', 'P' };
+
+Checkpoint::Checkpoint(const char* generator, size_t width, size_t height, const char* params)
+    : m_key(MakeMaskCacheKey(generator, width, height, params))
+{
+    char fileName[256];
+    sprintf(fileName, "%s/%016llx.checkpoint", CHECKPOINT_DIRECTORY(), (unsigned long long)m_key.hash);
+    m_fileName = fileName;
+    m_lastSave = std::chrono::high_resolution_clock::now();
+}
+
+bool Checkpoint::Due() const
+{
+    if (!CHECKPOINT())
+        return false;
+
+    std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::duration<double>>(now - m_lastSave).count() >= double(CHECKPOINT_INTERVAL_SECONDS());
+}
+
+Checkpoint::~Checkpoint()
+{
+    // a save that was started but not finished leaves its temporary file behind, which the next save overwrites
+    if (m_saveFile)
+        fclose(m_saveFile);
+    if (m_loadFile)
+        fclose(m_loadFile);
+}
+
+// ftell() is 32 bits on windows, and checkpoints of big masks can be bigger than that
+static bool GetFileSize(FILE* file, uint64_t& size)
+{
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0)
+        return false;
+    long long end = _ftelli64(file);
+    bool success = end >= 0 && _fseeki64(file, 0, SEEK_SET) == 0;
+#else
+    if (fseeko(file, 0, SEEK_END) != 0)
+        return false;
+    off_t end = ftello(file);
+    bool success = end >= 0 && fseeko(file, 0, SEEK_SET) == 0;
+#endif
+    size = success ? uint64_t(end) : 0;
+    return success;
+}
+
+bool Checkpoint::Load()
+{
+    if (!CHECKPOINT() || !CHECKPOINT_RESUME())
+        return false;
+
+    FILE* file = nullptr;
+    fopen_s(&file, m_fileName.c_str(), "rb");
+    if (!file)
+        return false;
+
+    // magic, description length, description, then the values the generator wrote, which are read as they are asked for
+    bool success = false;
+    uint64_t fileSize = 0;
+    char magic[4];
+    uint32_t descriptionLength = 0;
+    if (GetFileSize(file, fileSize) &&
+        fread(magic, 1, 4, file) == 4 && memcmp(magic, c_checkpointMagic, 4) == 0 &&
+        fread(&descriptionLength, sizeof(descriptionLength), 1, file) == 1 && descriptionLength == m_key.description.size())
+    {
+        std::string description(descriptionLength, ' ');
+        success = fread(&description[0], 1, descriptionLength, file) == descriptionLength && description == m_key.description;
+    }
+
+    if (!success)
+    {
+        fclose(file);
+        return false;
+    }
+
+    m_loadFile = file;
+    m_loadRemaining = fileSize - (4 + sizeof(descriptionLength) + descriptionLength);
+    m_readFailed = false;
+    printf("Loaded checkpoint %s\n", m_fileName.c_str());
+    return true;
+}
+
+bool Checkpoint::FinishLoad()
+{
+    if (m_loadFile)
+    {
+        fclose(m_loadFile);
+        m_loadFile = nullptr;
+    }
+    m_loadRemaining = 0;
+    return !m_readFailed;
+}
+
+void Checkpoint::Save()
+{
+    // a checkpoint with no values still has the header
+    if (!m_saveFile)
+        WriteBytes(nullptr, 0);
+
+    bool success = !m_saveFailed;
+    if (m_saveFile)
+        success = (fclose(m_saveFile) == 0) && success;
+    m_saveFile = nullptr;
+
+    // replace the old checkpoint in one step, so there is always a whole checkpoint on disk.
+    // rename() doesn't replace an existing file on windows.
+    std::string tempFileName = m_fileName + ".tmp";
+    if (success)
+    {
+#ifdef _WIN32
+        success = MoveFileExA(tempFileName.c_str(), m_fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        success = rename(tempFileName.c_str(), m_fileName.c_str()) == 0;
+#endif
+    }
+
+    if (!success)
+        printf("\nCould not write checkpoint %s\n", m_fileName.c_str());
+
+    m_saveFailed = false;
+    m_lastSave = std::chrono::high_resolution_clock::now();
+}
+
+void Checkpoint::Remove()
+{
+    remove(m_fileName.c_str());
+}
+
+void Checkpoint::WriteString(const std::string& text)
+{
+    Write(uint64_t(text.size()));
+    WriteBytes(text.data(), text.size());
+}
+
+void Checkpoint::ReadString(std::string& text)
+{
+    uint64_t length = 0;
+    Read(length);
+    if (m_readFailed || length > m_loadRemaining)
+    {
+        m_readFailed = true;
+        return;
+    }
+    text.resize(size_t(length));
+    if (length > 0)
+        ReadBytes(&text[0], size_t(length));
+}
+
+// the standard library can write and read the state of the standard random number generators as text
+void Checkpoint::WriteRNG(const std::mt19937& rng)
+{
+    std::ostringstream stream;
+    stream << rng;
+    WriteString(stream.str());
+}
+
+void Checkpoint::ReadRNG(std::mt19937& rng)
+{
+    std::string text;
+    ReadString(text);
+    if (m_readFailed)
+        return;
+
+    std::istringstream stream(text);
+    stream >> rng;
+    if (stream.fail())
+        m_readFailed = true;
+}
+
+void Checkpoint::WriteBytes(const void* data, size_t size)
+{
+    // the first write after a save starts the temporary file, with the header that says which generation it's for
+    if (!m_saveFile && !m_saveFailed)
+    {
+        MakeDirectory(CHECKPOINT_DIRECTORY());
+
+        std::string tempFileName = m_fileName + ".tmp";
+        fopen_s(&m_saveFile, tempFileName.c_str(), "wb");
+        uint32_t descriptionLength = uint32_t(m_key.description.size());
+        m_saveFailed = !m_saveFile ||
+            fwrite(c_checkpointMagic, 1, 4, m_saveFile) != 4 ||
+            fwrite(&descriptionLength, sizeof(descriptionLength), 1, m_saveFile) != 1 ||
+            fwrite(m_key.description.data(), 1, descriptionLength, m_saveFile) != descriptionLength;
+    }
+
+    if (m_saveFile && size > 0 && fwrite(data, 1, size, m_saveFile) != size)
+        m_saveFailed = true;
+}
+
+void Checkpoint::ReadBytes(void* data, size_t size)
+{
+    if (m_readFailed || !m_loadFile || size > m_loadRemaining || fread(data, 1, size, m_loadFile) != size)
+    {
+        m_readFailed = true;
+        return;
+    }
+    m_loadRemaining -= size;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "maskcache.h"
+
+// Lets long running generators save their state every CHECKPOINT_INTERVAL_SECONDS(), and pick up from the last save when they are
+// run again after being stopped. A resumed run gives exactly the same mask as one that wasn't stopped.
+// Checkpoints are keyed the same way as the mask cache, by the generator, size and parameters. The key is stored in the file and checked
+// on load, so a checkpoint is only resumed by the same generation that saved it. The file is deleted when the generator finishes.
+// The file is written to a temporary name and renamed, so being stopped while saving leaves the previous checkpoint intact.
+// Values go straight to and from the file as they are written and read, so saving memory mapped state doesn't pull it all into memory.
+class Checkpoint
+{
+public:
+    Checkpoint(const char* generator, size_t width, size_t height, const char* params);
+    ~Checkpoint();
+
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    // true if CHECKPOINT() is on and it's been CHECKPOINT_INTERVAL_SECONDS() since the last save
+    bool Due() const;
+
+    // Loads the checkpoint if CHECKPOINT() and CHECKPOINT_RESUME() are on and there is one for this key.
+    // The values are then read back in the order they were written, and then FinishLoad() is called.
+    bool Load();
+
+    // closes the loaded file, and returns whether all the values read were there
+    bool FinishLoad();
+
+    // saving is writing the values, then calling Save()
+    void Save();
+
+    // deletes the checkpoint file
+    void Remove();
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        WriteBytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void Read(T& value)
+    {
+        ReadBytes(&value, sizeof(T));
+    }
+
+    // std::vector, or anything else with size(), resize() and data()
+    template <typename TVECTOR>
+    void WriteVector(const TVECTOR& values)
+    {
+        Write(uint64_t(values.size()));
+        if (values.size() > 0)
+            WriteBytes(values.data(), values.size() * sizeof(values[0]));
+    }
+
+    template <typename TVECTOR>
+    void ReadVector(TVECTOR& values)
+    {
+        uint64_t count = 0;
+        Read(count);
+        if (m_readFailed || count > m_loadRemaining / sizeof(values[0]))
+        {
+            m_readFailed = true;
+            return;
+        }
+        values.resize(size_t(count));
+        if (count > 0)
+            ReadBytes(values.data(), size_t(count) * sizeof(values[0]));
+    }
+
+    // std::vector<bool>, or anything else with size(), resize() and [] of bools. Stored 8 to a byte, a chunk at a time.
+    template <typename TBITS>
+    void WriteBits(const TBITS& bits)
+    {
+        const uint64_t byteCount = (uint64_t(bits.size()) + 7) / 8;
+        Write(uint64_t(bits.size()));
+        Write(byteCount);
+
+        std::vector<uint8_t> bytes;
+        for (size_t chunkStart = 0; chunkStart < bits.size(); chunkStart += c_bitsChunkSize)
+        {
+            size_t chunkEnd = std::min(chunkStart + c_bitsChunkSize, bits.size());
+            bytes.assign((chunkEnd - chunkStart + 7) / 8, 0);
+            for (size_t index = chunkStart; index < chunkEnd; ++index)
+            {
+                if (bits[index])
+                    bytes[(index - chunkStart) / 8] |= uint8_t(1 << (index % 8));
+            }
+            WriteBytes(bytes.data(), bytes.size());
+        }
+    }
+
+    template <typename TBITS>
+    void ReadBits(TBITS& bits)
+    {
+        uint64_t count = 0;
+        uint64_t byteCount = 0;
+        Read(count);
+        Read(byteCount);
+        if (m_readFailed || byteCount != (count + 7) / 8 || byteCount > m_loadRemaining)
+        {
+            m_readFailed = true;
+            return;
+        }
+
+        bits.resize(size_t(count));
+        std::vector<uint8_t> bytes;
+        for (size_t chunkStart = 0; chunkStart < bits.size() && !m_readFailed; chunkStart += c_bitsChunkSize)
+        {
+            size_t chunkEnd = std::min(chunkStart + c_bitsChunkSize, bits.size());
+            bytes.resize((chunkEnd - chunkStart + 7) / 8);
+            ReadBytes(bytes.data(), bytes.size());
+            for (size_t index = chunkStart; index < chunkEnd; ++index)
+                bits[index] = (bytes[(index - chunkStart) / 8] & (1 << (index % 8))) != 0;
+        }
+    }
+
+    void WriteString(const std::string& text);
+    void ReadString(std::string& text);
+
+    // the full state of the random number generator, so a resumed run gets the same random numbers
+    void WriteRNG(const std::mt19937& rng);
+    void ReadRNG(std::mt19937& rng);
+
+private:
+    // a multiple of 8, so every chunk but the last is whole bytes
+    static const size_t c_bitsChunkSize = size_t(1) << 23;
+
+    void WriteBytes(const void* data, size_t size);
+    void ReadBytes(void* data, size_t size);
+
+    MaskCacheKey m_key;
+    std::string m_fileName;
+    FILE* m_saveFile = nullptr; // the temporary file being written, opened by the first write after a save
+    bool m_saveFailed = false;
+    FILE* m_loadFile = nullptr;
+    uint64_t m_loadRemaining = 0; // how many bytes are left to read in the loaded file
+    bool m_readFailed = false;
+    std::chrono::high_resolution_clock::time_point m_lastSave;
+};
@@ -3,7 +3,11 @@
 #include "simple_fft/fft_settings.h"
 #include "simple_fft/fft.h"
 
+#include "fft2d.h"
+#include "image.h"
 #include "misc.h"
+#include "settings.h"
+#include "spectrum.h"
 
 #include <algorithm>
 #include <vector>
@@ -32,37 +36,55 @@ struct ComplexImage2D
     }
 };
 
-template <typename T>
-void DFT(const std::vector<T>& imageSrc, std::vector<T>& imageDest, size_t width)
+// DFTs src and writes the magnitudes into dest, with DC in the center, normalized so the largest magnitude is the max value of T.
+// The images can be any size, and dest can be a window into a bigger image, to make composites without copies.
+// If metrics is not null, spectral metrics are calculated from the DFT and written into it.
+// imageSrc can be a view of T or const T.
+template <typename TSRC, typename T>
+void DFT(const ImageView<TSRC>& imageSrc, const ImageView<T>& imageDest, SpectralMetrics* metrics = nullptr)
 {
-    // convert the source image to float and store it in a complex image so it can be DFTd
-    ComplexImage2D complexImageIn(width, width);
-    for (size_t index = 0, count = width * width; index < count; ++index)
-        complexImageIn.pixels[index] = float(imageSrc[index]) / float(std::numeric_limits<T>::max());
+    const size_t width = imageSrc.m_width;
+    const size_t height = imageSrc.m_height;
+
+    // convert the source image to float so it can be DFTd
+    std::vector<float> imageFloat(width * height);
+    for (size_t y = 0; y < height; ++y)
+    {
+        const T* src = imageSrc.Row(y);
+        for (size_t x = 0; x < width; ++x)
+            imageFloat[y * width + x] = float(src[x]) / float(std::numeric_limits<T>::max());
+    }
 
-    // DFT the image to get frequency of the samples
-    const char* error = nullptr;
-    ComplexImage2D complexImageOut(width, width);
-    simple_fft::FFT(complexImageIn, complexImageOut, width, width, error);
+    // DFT the image to get the power of the frequencies
+    std::vector<float> power;
+    PowerSpectrum2D(imageFloat.data(), width, height, power);
 
-    // TODO: for some reason, the DC is huge. i'm not sure why...
-    complexImageOut(0, 0) = 0.0f;
+    // calculate the metrics from the power spectrum, normalized so white noise has the same power at every frequency regardless of size
+    if (metrics)
+    {
+        std::vector<float> normalizedPower(width * height);
+        for (size_t index = 0, count = width * height; index < count; ++index)
+            normalizedPower[index] = power[index] / float(count);
+        CalculateSpectralMetrics(normalizedPower, width, height, SPECTRUM_LOW_FREQUENCY_CUTOFF(), *metrics);
+    }
 
-    // get the magnitudes and max magnitude
+    // DC is the sum of all the pixels, which is huge compared to everything else, so zero it out to be able to see the rest
+    power[0] = 0.0f;
+
+    // get the magnitudes and max magnitude, shifting DC to the center
     std::vector<float> magnitudes;
     float maxMag = 0.0f;
     {
-        magnitudes.resize(width * width, 0.0f);
+        magnitudes.resize(width * height, 0.0f);
         float* dest = magnitudes.data();
-        for (size_t y = 0; y < width; ++y)
+        for (size_t y = 0; y < height; ++y)
         {
-            size_t srcY = (y + width / 2) % width;
+            size_t srcY = (y + height / 2) % height;
             for (size_t x = 0; x < width; ++x)
             {
                 size_t srcX = (x + width / 2) % width;
 
-                const complex_type& c = complexImageOut(srcX, srcY);
-                float mag = float(sqrt(c.real()*c.real() + c.imag()*c.imag()));
+                float mag = sqrtf(power[srcY * width + srcX]);
                 maxMag = std::max(mag, maxMag);
                 *dest = mag;
                 ++dest;
@@ -73,11 +95,10 @@ void DFT(const std::vector<T>& imageSrc, std::vector<T>& imageDest, size_t width
     // normalize the magnitudes and convert it back to a type T image
     //const float c = 1.0f / log(1.0f / 255.0f + maxMag);
     {
-        imageDest.resize(width * width);
         const float* src = magnitudes.data();
-        T* dest = imageDest.data();
-        for (size_t y = 0; y < width; ++y)
+        for (size_t y = 0; y < height; ++y)
         {
+            T* dest = imageDest.Row(y);
             for (size_t x = 0; x < width; ++x)
             {
                 //float normalized = c * log(1.0f / 255.0f + *src);
@@ -85,11 +106,18 @@ void DFT(const std::vector<T>& imageSrc, std::vector<T>& imageDest, size_t width
 
                 float value = Lerp(0, float(std::numeric_limits<T>::max() + 1), normalized);
                 value = Clamp(0.0f, float(std::numeric_limits<T>::max()), value);
-                *dest = T(value);
+                dest[x] = T(value);
 
                 ++src;
-                ++dest;
             }
         }
     }
-}
\ No newline at end of file
+}
+
+// square, tightly packed version of the above
+template <typename T>
+void DFT(const std::vector<T>& imageSrc, std::vector<T>& imageDest, size_t width, SpectralMetrics* metrics = nullptr)
+{
+    imageDest.resize(width * width);
+    DFT(MakeImageView(imageSrc, width, width), MakeImageView(imageDest, width, width), metrics);
+}
@@ -0,0 +1,122 @@
+#include "equalize.h"
+
+#include <algorithm>
+#include <string.h>
+
+static const size_t c_radixBits = 8;
+static const size_t c_radixBuckets = size_t(1) << c_radixBits;
+static const size_t c_radixPasses = 64 / c_radixBits;
+static const size_t c_radixBlockSize = 16384; // how many items each block of the parallel sort works on
+
+static inline uint32_t SortableFloatBits(float value)
+{
+    // flip all the bits of negative numbers, and just the sign bit of positive numbers, so they sort correctly as unsigned ints
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+}
+
+void SortByValue(std::mt19937& rng, const std::vector<float>& values, RankScratch& scratch)
+{
+    const size_t count = values.size();
+
+    scratch.keys.resize(count);
+    scratch.keysTemp.resize(count);
+    scratch.indices.resize(count);
+    scratch.indicesTemp.resize(count);
+    if (count == 0)
+        return;
+
+    // make the keys. The rng isn't thread safe, so this part is serial.
+    for (size_t index = 0; index < count; ++index)
+    {
+        scratch.keys[index] = (uint64_t(SortableFloatBits(values[index])) << 32) | uint64_t(rng());
+        scratch.indices[index] = uint32_t(index);
+    }
+
+    // The blocks are fixed size so that the sort gives the same results no matter how many threads there are.
+    const size_t blockCount = (count + c_radixBlockSize - 1) / c_radixBlockSize;
+    scratch.histograms.resize(blockCount * c_radixBuckets);
+
+    for (size_t pass = 0; pass < c_radixPasses; ++pass)
+    {
+        const size_t shift = pass * c_radixBits;
+
+        // count how many of each digit are in each block
+        #pragma omp parallel for
+        for (int block = 0; block < int(blockCount); ++block)
+        {
+            size_t* histogram = &scratch.histograms[block * c_radixBuckets];
+            memset(histogram, 0, sizeof(size_t) * c_radixBuckets);
+
+            const size_t begin = block * c_radixBlockSize;
+            const size_t end = std::min(begin + c_radixBlockSize, count);
+            for (size_t index = begin; index < end; ++index)
+                histogram[(scratch.keys[index] >> shift) & (c_radixBuckets - 1)]++;
+        }
+
+        // if every key has the same digit, this pass wouldn't change anything so skip it
+        {
+            size_t digitTotal = 0;
+            size_t firstDigit = (scratch.keys[0] >> shift) & (c_radixBuckets - 1);
+            for (size_t block = 0; block < blockCount; ++block)
+                digitTotal += scratch.histograms[block * c_radixBuckets + firstDigit];
+            if (digitTotal == count)
+                continue;
+        }
+
+        // turn the counts into write offsets. Digit major, block minor, so the sort is stable.
+        size_t offset = 0;
+        for (size_t digit = 0; digit < c_radixBuckets; ++digit)
+        {
+            for (size_t block = 0; block < blockCount; ++block)
+            {
+                size_t& entry = scratch.histograms[block * c_radixBuckets + digit];
+                size_t digitCount = entry;
+                entry = offset;
+                offset += digitCount;
+            }
+        }
+
+        // scatter the keys and indices to their new locations
+        #pragma omp parallel for
+        for (int block = 0; block < int(blockCount); ++block)
+        {
+            size_t* offsets = &scratch.histograms[block * c_radixBuckets];
+
+            const size_t begin = block * c_radixBlockSize;
+            const size_t end = std::min(begin + c_radixBlockSize, count);
+            for (size_t index = begin; index < end; ++index)
+            {
+                uint64_t key = scratch.keys[index];
+                size_t dest = offsets[(key >> shift) & (c_radixBuckets - 1)]++;
+                scratch.keysTemp[dest] = key;
+                scratch.indicesTemp[dest] = scratch.indices[index];
+            }
+        }
+
+        std::swap(scratch.keys, scratch.keysTemp);
+        std::swap(scratch.indices, scratch.indicesTemp);
+    }
+}
+
+void MakeRanks(std::mt19937& rng, const std::vector<float>& values, std::vector<size_t>& ranks, RankScratch& scratch)
+{
+    SortByValue(rng, values, scratch);
+
+    ranks.resize(values.size());
+    #pragma omp parallel for
+    for (int rank = 0; rank < int(values.size()); ++rank)
+        ranks[scratch.indices[rank]] = size_t(rank);
+}
+
+void EqualizeHistogram(std::mt19937& rng, std::vector<float>& values, RankScratch& scratch)
+{
+    SortByValue(rng, values, scratch);
+
+    // use the value's place in the sorted array as the new value
+    const size_t count = values.size();
+    #pragma omp parallel for
+    for (int rank = 0; rank < int(count); ++rank)
+        values[scratch.indices[rank]] = float(rank) / float(count - 1);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <random>
+#include <stdint.h>
+#include <vector>
+
+// Caller owned scratch memory for ranking values. Keeping one of these alive across calls avoids re-allocating
+// the sort buffers every pass, and having each caller own its own makes ranking thread safe.
+struct RankScratch
+{
+    // keys are the float bit pattern (made sortable as unsigned) in the high 32 bits, and a random tie breaker in the low 32 bits
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> keysTemp;
+
+    // after SortByValue(), indices[rank] is the index of the value with that rank
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> indicesTemp;
+
+    // per block digit histograms for the parallel radix sort
+    std::vector<size_t> histograms;
+};
+
+// Sorts the indices of the values by value, using a parallel LSD radix sort. Ties are ordered randomly using the rng.
+// The result is left in scratch.indices.
+void SortByValue(std::mt19937& rng, const std::vector<float>& values, RankScratch& scratch);
+
+// ranks[i] becomes the rank of values[i], from 0 to values.size()-1. Ties are ordered randomly.
+void MakeRanks(std::mt19937& rng, const std::vector<float>& values, std::vector<size_t>& ranks, RankScratch& scratch);
+
+// Replaces each value with its rank mapped to [0,1], which makes the histogram perfectly flat. Ties are ordered randomly.
+void EqualizeHistogram(std::mt19937& rng, std::vector<float>& values, RankScratch& scratch);
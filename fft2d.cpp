@@ -0,0 +1,382 @@
+#include "fft2d.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <math.h>
+#include <stdint.h>
+
+static const size_t c_transposeBlockSize = 16;
+
+struct FFTPlan
+{
+    size_t size;
+    std::vector<uint32_t> bitReverse;       // where each index moves to before the butterflies. Only for powers of two.
+    AlignedVector<ComplexFloat> twiddles;   // exp(-2 pi i k / size) for k in [0, size/2), or [0, size) for mixed radix plans
+
+    // sizes that aren't a power of two, but only have factors of 2, 3 and 5, use a mixed radix FFT with these radices
+    std::vector<uint32_t> radices;
+
+    // other sizes use Bluestein's algorithm, which does the FFT as a convolution with a chirp,
+    // using power of two FFTs of bluesteinPlan->size, which is at least 2*size-1.
+    const FFTPlan* bluesteinPlan = nullptr;
+    AlignedVector<ComplexFloat> chirp;      // exp(-pi i k^2 / size) for k in [0, size)
+    AlignedVector<ComplexFloat> chirpFFT;   // the FFT of the conjugate chirp, wrapped around to be symmetric, divided by bluesteinPlan->size
+};
+
+struct FFTScratch
+{
+    AlignedVector<ComplexFloat> rows;       // the row FFTs, height x (width/2+1)
+    AlignedVector<ComplexFloat> halfRow;    // the half length complex FFT used by the real FFT of a row
+    AlignedVector<ComplexFloat> spectrum;   // used by PowerSpectrum2D
+    AlignedVector<ComplexFloat> bluestein;  // the padded convolution of Bluestein's algorithm
+    AlignedVector<ComplexFloat> mixedRadix[2]; // the mixed radix FFT goes back and forth between these
+};
+
+static bool IsPowerOfTwo(size_t size)
+{
+    return (size & (size - 1)) == 0;
+}
+
+static FFTScratch& GetFFTScratch();
+static void ComplexFFT(ComplexFloat* data, size_t count, size_t stride, const FFTPlan& plan);
+
+static const FFTPlan& GetFFTPlan(size_t size)
+{
+    // recursive because making a Bluestein plan gets the power of two plan it uses
+    static std::recursive_mutex s_mutex;
+    static std::map<size_t, std::unique_ptr<FFTPlan>> s_plans;
+
+    std::lock_guard<std::recursive_mutex> lock(s_mutex);
+
+    std::unique_ptr<FFTPlan>& plan = s_plans[size];
+    if (!plan)
+    {
+        plan.reset(new FFTPlan);
+        plan->size = size;
+
+        if (IsPowerOfTwo(size))
+        {
+            size_t bits = 0;
+            while ((size_t(1) << bits) < size)
+                bits++;
+
+            plan->bitReverse.resize(size);
+            for (size_t index = 0; index < size; ++index)
+            {
+                size_t reversed = 0;
+                for (size_t bit = 0; bit < bits; ++bit)
+                    reversed |= ((index >> bit) & 1) << (bits - 1 - bit);
+                plan->bitReverse[index] = uint32_t(reversed);
+            }
+        }
+        else
+        {
+            // the larger radices go first. 4 is used where it can be since it's cheaper than two radix 2 passes.
+            static const uint32_t c_radices[] = { 5, 4, 3, 2 };
+            size_t remaining = size;
+            for (uint32_t radix : c_radices)
+            {
+                while (remaining % radix == 0)
+                {
+                    plan->radices.push_back(radix);
+                    remaining /= radix;
+                }
+            }
+            if (remaining != 1)
+                plan->radices.clear();
+        }
+
+        // calculated in double to keep the float twiddles accurate
+        const double c_pi = 3.14159265358979323846;
+        const size_t twiddleCount = plan->radices.empty() ? size / 2 : size;
+        plan->twiddles.resize(twiddleCount);
+        for (size_t index = 0; index < twiddleCount; ++index)
+        {
+            double angle = -2.0 * c_pi * double(index) / double(size);
+            plan->twiddles[index] = ComplexFloat(float(cos(angle)), float(sin(angle)));
+        }
+
+        if (!IsPowerOfTwo(size) && plan->radices.empty())
+        {
+            size_t bluesteinSize = 1;
+            while (bluesteinSize < size * 2 - 1)
+                bluesteinSize *= 2;
+            plan->bluesteinPlan = &GetFFTPlan(bluesteinSize);
+
+            // k^2 is taken mod 2*size so the angle stays small enough to be accurate
+            plan->chirp.resize(size);
+            for (size_t index = 0; index < size; ++index)
+            {
+                double angle = -c_pi * double((index * index) % (size * 2)) / double(size);
+                plan->chirp[index] = ComplexFloat(float(cos(angle)), float(sin(angle)));
+            }
+
+            // the 1/bluesteinSize of the inverse FFT is folded in here
+            const float scale = 1.0f / float(bluesteinSize);
+            plan->chirpFFT.assign(bluesteinSize, ComplexFloat(0.0f, 0.0f));
+            plan->chirpFFT[0] = std::conj(plan->chirp[0]) * scale;
+            for (size_t index = 1; index < size; ++index)
+            {
+                plan->chirpFFT[index] = std::conj(plan->chirp[index]) * scale;
+                plan->chirpFFT[bluesteinSize - index] = std::conj(plan->chirp[index]) * scale;
+            }
+            ComplexFFT(plan->chirpFFT.data(), bluesteinSize, 1, *plan->bluesteinPlan);
+        }
+    }
+    return *plan;
+}
+
+static FFTScratch& GetFFTScratch()
+{
+    thread_local FFTScratch s_scratch;
+    return s_scratch;
+}
+
+static inline ComplexFloat Multiply(const ComplexFloat& A, const ComplexFloat& B)
+{
+    // written out because std::complex multiplication can do slow inf/nan handling
+    return ComplexFloat(A.real() * B.real() - A.imag() * B.imag(), A.real() * B.imag() + A.imag() * B.real());
+}
+
+// in place radix 2 decimation in time FFT of count values that are stride apart. count must be a power of two.
+static void ComplexFFTRadix2(ComplexFloat* data, size_t count, size_t stride, const FFTPlan& plan)
+{
+    for (size_t index = 0; index < count; ++index)
+    {
+        size_t reversed = plan.bitReverse[index];
+        if (reversed > index)
+            std::swap(data[index * stride], data[reversed * stride]);
+    }
+
+    for (size_t length = 2; length <= count; length *= 2)
+    {
+        const size_t halfLength = length / 2;
+        const size_t twiddleStep = count / length;
+        for (size_t start = 0; start < count; start += length)
+        {
+            for (size_t index = 0; index < halfLength; ++index)
+            {
+                ComplexFloat& even = data[(start + index) * stride];
+                ComplexFloat& odd = data[(start + index + halfLength) * stride];
+                ComplexFloat t = Multiply(plan.twiddles[index * twiddleStep], odd);
+                odd = even - t;
+                even = even + t;
+            }
+        }
+    }
+}
+
+// Self sorting (Stockham) mixed radix FFT. Each pass takes the n = count/s point FFTs that are interleaved s apart in src and splits
+// them into radix n/radix point FFTs, writing them interleaved s*radix apart in dest: for j in [0, n/radix) and r in [0, radix),
+// dest[k + s*(radix*j + r)] = w^(j*r) * sum over q of src[k + s*(j + q*n/radix)] * exp(-2 pi i q r / radix), where w = exp(-2 pi i / n).
+// After the last pass, the FFT is in order in whichever buffer was written last.
+static void ComplexFFTMixedRadix(ComplexFloat* data, size_t count, size_t stride, const FFTPlan& plan)
+{
+    FFTScratch& scratch = GetFFTScratch();
+    scratch.mixedRadix[0].resize(count);
+    scratch.mixedRadix[1].resize(count);
+    ComplexFloat* src = scratch.mixedRadix[0].data();
+    ComplexFloat* dest = scratch.mixedRadix[1].data();
+
+    for (size_t index = 0; index < count; ++index)
+        src[index] = data[index * stride];
+
+    size_t n = count;
+    size_t s = 1;
+    for (uint32_t radix : plan.radices)
+    {
+        const size_t m = n / radix;
+
+        // exp(-2 pi i k / radix)
+        ComplexFloat roots[5];
+        for (uint32_t k = 0; k < radix; ++k)
+            roots[k] = plan.twiddles[k * (count / radix)];
+
+        for (size_t j = 0; j < m; ++j)
+        {
+            for (size_t k = 0; k < s; ++k)
+            {
+                ComplexFloat in[5];
+                for (uint32_t q = 0; q < radix; ++q)
+                    in[q] = src[k + s * (j + q * m)];
+
+                for (uint32_t r = 0; r < radix; ++r)
+                {
+                    ComplexFloat sum = in[0];
+                    uint32_t rootIndex = 0;
+                    for (uint32_t q = 1; q < radix; ++q)
+                    {
+                        rootIndex += r;
+                        if (rootIndex >= radix)
+                            rootIndex -= radix;
+                        sum += Multiply(in[q], roots[rootIndex]);
+                    }
+
+                    // w^(j*r) = exp(-2 pi i j r s / count), and j*r*s < count
+                    dest[k + s * (radix * j + r)] = (r == 0) ? sum : Multiply(sum, plan.twiddles[j * r * s]);
+                }
+            }
+        }
+
+        std::swap(src, dest);
+        n = m;
+        s *= radix;
+    }
+
+    for (size_t index = 0; index < count; ++index)
+        data[index * stride] = src[index];
+}
+
+// Bluestein's algorithm: X[k] = chirp[k] * sum(x[n] * chirp[n] * conj(chirp[k-n])), which is a convolution that is done with
+// power of two FFTs. The inverse FFT is done as a forward FFT of the conjugate.
+static void ComplexFFTBluestein(ComplexFloat* data, size_t count, size_t stride, const FFTPlan& plan)
+{
+    const FFTPlan& bluesteinPlan = *plan.bluesteinPlan;
+    AlignedVector<ComplexFloat>& work = GetFFTScratch().bluestein;
+
+    work.assign(bluesteinPlan.size, ComplexFloat(0.0f, 0.0f));
+    for (size_t index = 0; index < count; ++index)
+        work[index] = Multiply(data[index * stride], plan.chirp[index]);
+
+    ComplexFFTRadix2(work.data(), bluesteinPlan.size, 1, bluesteinPlan);
+    for (size_t index = 0; index < bluesteinPlan.size; ++index)
+        work[index] = std::conj(Multiply(work[index], plan.chirpFFT[index]));
+    ComplexFFTRadix2(work.data(), bluesteinPlan.size, 1, bluesteinPlan);
+
+    for (size_t index = 0; index < count; ++index)
+        data[index * stride] = Multiply(std::conj(work[index]), plan.chirp[index]);
+}
+
+// in place FFT of count values that are stride apart
+static void ComplexFFT(ComplexFloat* data, size_t count, size_t stride, const FFTPlan& plan)
+{
+    if (!plan.radices.empty())
+        ComplexFFTMixedRadix(data, count, stride, plan);
+    else if (plan.bluesteinPlan)
+        ComplexFFTBluestein(data, count, stride, plan);
+    else
+        ComplexFFTRadix2(data, count, stride, plan);
+}
+
+// FFT of count real values, giving the count/2+1 non redundant frequencies.
+// The real values are packed as count/2 complex values and a half length complex FFT is done, then the results are split apart.
+// plan is for count, halfPlan is for count/2.
+static void RealFFT(const float* src, size_t count, ComplexFloat* dest, AlignedVector<ComplexFloat>& halfRow, const FFTPlan& plan, const FFTPlan& halfPlan)
+{
+    if (count == 1)
+    {
+        dest[0] = ComplexFloat(src[0], 0.0f);
+        return;
+    }
+
+    // odd sizes can't be packed into half as many complex values, so are done as a full length complex FFT
+    if (count % 2 == 1)
+    {
+        halfRow.resize(count);
+        for (size_t index = 0; index < count; ++index)
+            halfRow[index] = ComplexFloat(src[index], 0.0f);
+
+        ComplexFFT(halfRow.data(), count, 1, plan);
+
+        for (size_t k = 0; k <= count / 2; ++k)
+            dest[k] = halfRow[k];
+        return;
+    }
+
+    const size_t half = count / 2;
+
+    halfRow.resize(half);
+    for (size_t index = 0; index < half; ++index)
+        halfRow[index] = ComplexFloat(src[index * 2], src[index * 2 + 1]);
+
+    ComplexFFT(halfRow.data(), half, 1, halfPlan);
+
+    for (size_t k = 0; k <= half; ++k)
+    {
+        ComplexFloat a = halfRow[k % half];
+        ComplexFloat b = std::conj(halfRow[(half - k) % half]);
+
+        ComplexFloat even = (a + b) * 0.5f;
+        ComplexFloat odd = (a - b) * 0.5f;
+        odd = ComplexFloat(odd.imag(), -odd.real()); // divide by i
+
+        ComplexFloat twiddle = (k < half) ? plan.twiddles[k] : ComplexFloat(-1.0f, 0.0f);
+        dest[k] = even + Multiply(twiddle, odd);
+    }
+}
+
+// The rows, the transpose and the columns are each split across threads. Every row and column is transformed the same way
+// no matter which thread does it, so the results don't depend on the thread count.
+void RealFFT2D(const float* src, size_t width, size_t height, AlignedVector<ComplexFloat>& spectrum)
+{
+    FFTScratch& scratch = GetFFTScratch();
+
+    const size_t columns = width / 2 + 1;
+
+    // get the plans up front so the threads don't fight over the plan cache lock
+    const FFTPlan& rowPlan = GetFFTPlan(width);
+    const FFTPlan& halfRowPlan = GetFFTPlan(std::max<size_t>(width / 2, 1));
+    const FFTPlan& columnPlan = GetFFTPlan(height);
+
+    // real FFT of each row. Each thread uses its own half row buffer.
+    scratch.rows.resize(height * columns);
+    ComplexFloat* rows = scratch.rows.data();
+    #pragma omp parallel for
+    for (int y = 0; y < int(height); ++y)
+        RealFFT(&src[y * width], width, &rows[y * columns], GetFFTScratch().halfRow, rowPlan, halfRowPlan);
+
+    // transpose in blocks, so that each column is contiguous for the column FFTs. Threads take rows of blocks in the destination.
+    spectrum.resize(columns * height);
+    ComplexFloat* dest = spectrum.data();
+    const int blockRows = int((columns + c_transposeBlockSize - 1) / c_transposeBlockSize);
+    #pragma omp parallel for
+    for (int blockRow = 0; blockRow < blockRows; ++blockRow)
+    {
+        size_t blockX = size_t(blockRow) * c_transposeBlockSize;
+        size_t endX = std::min(blockX + c_transposeBlockSize, columns);
+        for (size_t blockY = 0; blockY < height; blockY += c_transposeBlockSize)
+        {
+            size_t endY = std::min(blockY + c_transposeBlockSize, height);
+            for (size_t y = blockY; y < endY; ++y)
+                for (size_t x = blockX; x < endX; ++x)
+                    dest[x * height + y] = rows[y * columns + x];
+        }
+    }
+
+    // complex FFT of each column
+    if (height > 1)
+    {
+        #pragma omp parallel for
+        for (int x = 0; x < int(columns); ++x)
+            ComplexFFT(&dest[x * height], height, 1, columnPlan);
+    }
+}
+
+void PowerSpectrum2D(const float* src, size_t width, size_t height, std::vector<float>& power)
+{
+    FFTScratch& scratch = GetFFTScratch();
+    RealFFT2D(src, width, height, scratch.spectrum);
+
+    // the columns past the middle are the complex conjugates of the ones before it: F(x,y) = conj(F(width-x, height-y))
+    power.resize(width * height);
+    const ComplexFloat* spectrum = scratch.spectrum.data();
+    #pragma omp parallel for
+    for (int y = 0; y < int(height); ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            size_t srcX = x;
+            size_t srcY = y;
+            if (x > width / 2)
+            {
+                srcX = width - x;
+                srcY = (height - y) % height;
+            }
+
+            const ComplexFloat& c = spectrum[srcX * height + srcY];
+            power[y * width + x] = c.real() * c.real() + c.imag() * c.imag();
+        }
+    }
+}
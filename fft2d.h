@@ -0,0 +1,22 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "aligned.h"
+
+// A float FFT for analyzing images, used instead of simple_fft which works in doubles on complex input.
+// The plans for each size (twiddle factors, bit reversal tables, radices, Bluestein chirps) are made once and cached, and the working buffers are
+// kept per thread, so repeated calls at the same size don't allocate.
+
+typedef std::complex<float> ComplexFloat;
+
+// Does a 2D FFT of a real valued width x height image. Any size works. Powers of two are fastest, sizes that only have factors
+// of 2, 3 and 5 (like 96, 360 and 640) use a mixed radix FFT, and other sizes use Bluestein's algorithm, which does each row or
+// column with power of two FFTs at least twice as long, so is a few times slower. All of them are O(N log N).
+// Since the input is real, only the width/2+1 non redundant columns of the spectrum are made. They are stored transposed,
+// so that frequency (x,y) is at spectrum[x * height + y].
+void RealFFT2D(const float* src, size_t width, size_t height, AlignedVector<ComplexFloat>& spectrum);
+
+// Makes |F|^2 for every frequency of a real valued width x height image, in the usual FFT layout, with DC at (0,0).
+void PowerSpectrum2D(const float* src, size_t width, size_t height, std::vector<float>& power);
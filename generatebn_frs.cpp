@@ -1,17 +1,18 @@
 #include "generatebn_frs.h"
+#include "ranks.h"
 #include "whitenoise.h"
 #include "scoped_timer.h"
 
-static void WriteLutValue(std::vector<double>& LUT, size_t width, size_t locx, size_t locy)
+static void WriteLutValue(std::vector<double>& LUT, size_t width, size_t height, size_t locx, size_t locy)
 {
     // process rows until we run out
     #pragma omp parallel for
-    for (int y = 0; y < width; ++y)
+    for (int y = 0; y < height; ++y)
     {
         // get y distance
         size_t disty = (y >= locy) ? (y - locy) : (locy - y);
-        if (disty > width / 2)
-            disty = width - disty;
+        if (disty > height / 2)
+            disty = height - disty;
 
         // process each column in this row
         for (size_t x = 0; x < width; ++x)
@@ -32,34 +33,36 @@ static void WriteLutValue(std::vector<double>& LUT, size_t width, size_t locx, s
 void GenerateBN_FRS(
     std::vector<uint8_t>& blueNoise,
     size_t width,
-    bool makeBlueNoise
+    size_t height,
+    bool makeBlueNoise,
+    std::vector<size_t>* ranksOut
 )
 {
     std::mt19937 rng(GetRNGSeed());
 
     // initialize data
-    std::vector<bool> binaryPattern(width*width, false);
-    std::vector<size_t> ranks(width*width, ~size_t(0));
-    std::vector<double> LUT(width*width, 0.0);
+    std::vector<bool> binaryPattern(width*height, false);
+    std::vector<size_t> ranks(width*height, ~size_t(0));
+    std::vector<double> LUT(width*height, 0.0);
 
     std::vector<size_t> emptyPixels;
-    emptyPixels.resize(width*width);
-    for (size_t i = 0; i < width*width; ++i)
+    emptyPixels.resize(width*height);
+    for (size_t i = 0; i < width*height; ++i)
         emptyPixels[i] = i;
 
     // put a first point in
     {
-        std::uniform_int_distribution<size_t> dist(0, width*width - 1);
+        std::uniform_int_distribution<size_t> dist(0, width*height - 1);
         size_t firstPoint = dist(rng);
 
         binaryPattern[firstPoint] = true;
         ranks[firstPoint] = 0;
         emptyPixels.erase(emptyPixels.begin() + firstPoint);
-        WriteLutValue(LUT, width, firstPoint % width, firstPoint / width);
+        WriteLutValue(LUT, width, height, firstPoint % width, firstPoint / width);
     }
 
     // put all of the rest of the points in
-    for (size_t insertPointIndex = 1; insertPointIndex < width*width; ++insertPointIndex)
+    for (size_t insertPointIndex = 1; insertPointIndex < width*height; ++insertPointIndex)
     {
         // shuffle the empty pixels
         std::shuffle(emptyPixels.begin(), emptyPixels.end(), rng);
@@ -101,18 +104,16 @@ void GenerateBN_FRS(
         binaryPattern[winningPixel] = true;
         ranks[winningPixel] = insertPointIndex;
         emptyPixels.erase(emptyPixels.begin() + winningCandidateIndex);
-        WriteLutValue(LUT, width, winningPixel % width, winningPixel / width);
+        WriteLutValue(LUT, width, height, winningPixel % width, winningPixel / width);
 
         // show what percentage we are done
-        printf("\r%i%%", int(100.0f * float(insertPointIndex) / float(width*width)));
+        printf("\r%i%%", int(100.0f * float(insertPointIndex) / float(width*height)));
     }
 
     // convert ranks to U8
-    {
-        blueNoise.resize(width*width);
-        for (size_t index = 0; index < width*width; ++index)
-            blueNoise[index] = uint8_t(ranks[index] * 256 / (width*width));
-    }
+    QuantizeRanks(ranks, blueNoise);
+    if (ranksOut)
+        *ranksOut = std::move(ranks);
 
     printf("\n");
 }
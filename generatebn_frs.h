@@ -7,5 +7,7 @@
 void GenerateBN_FRS(
     std::vector<uint8_t>& blueNoise,
     size_t width,
-    bool makeBlueNoise // if false, makes red noise
+    size_t height,
+    bool makeBlueNoise, // if false, makes red noise
+    std::vector<size_t>* ranksOut = nullptr // if not null, gets the full precision rank of each pixel, from 0 to width*height-1
 );
\ No newline at end of file
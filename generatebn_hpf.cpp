@@ -1,52 +1,15 @@
 #include "blur.h"
 #include "convert.h"
+#include "equalize.h"
 #include "generatebn_hpf.h"
 #include "whitenoise.h"
 
-static void NormalizeHistogram(std::mt19937& rng, std::vector<float>& image, size_t width)
-{
-    struct SHistogramHelper
-    {
-        float value;
-        size_t pixelIndex;
-    };
-    static std::vector<SHistogramHelper> pixels;
-    pixels.resize(width*width);
-
-    // put all the pixels into the array
-    for (size_t i = 0, c = pixels.size(); i < c; ++i)
-    {
-        pixels[i].value = image[i];
-        pixels[i].pixelIndex = i;
-    }
-
-    // shuffle the pixels to randomly order ties. not as big a deal with floating point pixel values though
-    std::shuffle(pixels.begin(), pixels.end(), rng);
-
-    // sort the pixels by value
-    std::sort(
-        pixels.begin(),
-        pixels.end(),
-        [](const SHistogramHelper& a, const SHistogramHelper& b)
-        {
-            return a.value < b.value;
-        }
-    );
-
-    // use the pixel's place in the array as the new value, and write it back to the image
-    for (size_t i = 0, c = width * width; i < c; ++i)
-    {
-        float value = float(i) / float(c - 1);
-        image[pixels[i].pixelIndex] = value;
-    }
-}
-
-void GenerateBN_HPF(std::vector<uint8_t>& blueNoise, size_t width, size_t numPasses, float sigma, bool makeRed)
+void GenerateBN_HPF(std::vector<uint8_t>& blueNoise, size_t width, size_t height, size_t numPasses, float sigma, bool makeRed, bool useRecursiveBlur)
 {
     // first make white noise
     std::mt19937 rng(GetRNGSeed());
     std::vector<uint8_t> pixels;
-    MakeWhiteNoise(rng, pixels, width);
+    MakeWhiteNoise(rng, pixels, width, height);
 
     // convert from uint8 to float
     std::vector<float> pixelsFloat;
@@ -54,9 +17,13 @@ void GenerateBN_HPF(std::vector<uint8_t>& blueNoise, size_t width, size_t numPas
 
     // repeatedly high pass filter and histogram fixup
     std::vector<float> pixelsFloatLowPassed;
+    RankScratch rankScratch;
     for (size_t index = 0; index < numPasses; ++index)
     {
-        GaussianBlur(pixelsFloat, pixelsFloatLowPassed, width, sigma);
+        if (useRecursiveBlur)
+            GaussianBlurRecursive(pixelsFloat, pixelsFloatLowPassed, width, height, sigma);
+        else
+            GaussianBlur(pixelsFloat, pixelsFloatLowPassed, width, height, sigma);
 
         if (!makeRed)
         {
@@ -72,7 +39,7 @@ void GenerateBN_HPF(std::vector<uint8_t>& blueNoise, size_t width, size_t numPas
         }
 
         // Do a histogram fixup
-        NormalizeHistogram(rng, pixelsFloat, width);
+        EqualizeHistogram(rng, pixelsFloat, rankScratch);
     }
 
     // convert back to uint8
@@ -1,7 +1,17 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <chrono>
+
+#include "checkpoint.h"
 #include "convert.h"
 #include "generatebn_paniq.h"
 #include "whitenoise.h"
 #include "vec.h"
+#include "settings.h"
+
+#if PANIQ_SIMD()
+#include <emmintrin.h>
+#endif
 
 #define R2 19
 #define SIGMA 1.414f
@@ -32,97 +42,359 @@ float distf(float v, float x) {
     return 1.0f - x;
 }
 
+// The taps of quantify_error() are the offsets within a disc of radius R2/2, not including the center.
+// They only depend on R2, so they are calculated at compile time.
+static const int c_tapRadiusSquared = (R2 * R2) / 4; // the largest integer distance squared that is <= (R2/2)^2
+
+static constexpr int CountTaps()
+{
+    int count = 0;
+    for (int sy = -R2 / 2; sy <= R2 / 2; ++sy)
+        for (int sx = -R2 / 2; sx <= R2 / 2; ++sx)
+            if ((sx*sx + sy * sy <= c_tapRadiusSquared) && (sx != 0 || sy != 0))
+                count++;
+    return count;
+}
+
+static const int c_tapCount = CountTaps();
+
+struct TapTable
+{
+    int offsetX[c_tapCount];
+    int offsetY[c_tapCount];
+};
+
+static constexpr TapTable MakeTapTable()
+{
+    TapTable table = {};
+    int index = 0;
+    for (int sy = -R2 / 2; sy <= R2 / 2; ++sy)
+    {
+        for (int sx = -R2 / 2; sx <= R2 / 2; ++sx)
+        {
+            if ((sx * sx + sy * sy > c_tapRadiusSquared) || (sx == 0 && sy == 0))
+                continue;
+
+            table.offsetX[index] = sx;
+            table.offsetY[index] = sy;
+            index++;
+        }
+    }
+    return table;
+}
+
+static constexpr TapTable c_taps = MakeTapTable();
+
+// The gaussian weight of each tap, and their sum, made once with the same float math that used to be done per tap per pixel.
+// The sums in quantify_error() are divided by the total weight at the end, like they always were, so the results don't change.
+struct TapWeights
+{
+    TapWeights()
+    {
+        total = 0.0f;
+        for (int tap = 0; tap < c_tapCount; ++tap)
+        {
+            float d = length(vec2{ float(c_taps.offsetX[tap]), float(c_taps.offsetY[tap]) });
+            weight[tap] = gaussian(d, SIGMA);
+            total += weight[tap];
+        }
+    }
+
+    float weight[c_tapCount];
+    float total;
+};
+
+static const TapWeights c_tapWeights;
+
 vec2 quantify_error(const std::vector<float>& oldNoise, size_t oldNoiseWidth, ivec2 p, ivec2 sz, float val0, float val1)
 {
-    float Rf = float(R2) / 2.0;
-    int R = int(Rf);
     float has0 = 0.0;
     float has1 = 0.0;
-    float w = 0.0;
 
-    for (int sy = -R; sy < R2; ++sy) {
-        for (int sx = -R; sx < R2; ++sx) {
-            float d = length(vec2{ float(sx), float(sy) });
-            if ((d > Rf) || ((sx == 0) && (sy == 0)))
-                continue;
-            ivec2 t = (p + ivec2{ sx, sy } +sz) % sz;
-            float v = oldNoise[t[1] * oldNoiseWidth + t[0]];
+    for (int tap = 0; tap < c_tapCount; ++tap)
+    {
+        // the taps reach R2/2 pixels away, which can be more than the size of the image, so it can wrap around more than once
+        int tx = ((p[0] + c_taps.offsetX[tap]) % sz[0] + sz[0]) % sz[0];
+        int ty = ((p[1] + c_taps.offsetY[tap]) % sz[1] + sz[1]) % sz[1];
+        float v = oldNoise[ty * oldNoiseWidth + tx];
 
-            float dist0 = abs(v - val0);
-            float dist1 = abs(v - val1);
+        float dist0 = abs(v - val0);
+        float dist1 = abs(v - val1);
 
-            float q = gaussian(d, SIGMA);
+        float q = c_tapWeights.weight[tap];
 
-            w += q;
-            has0 += distf(val0, dist0) * q;
-            has1 += distf(val1, dist1) * q;
-        }
+        has0 += distf(val0, dist0) * q;
+        has1 += distf(val1, dist1) * q;
     }
 
-    vec2 result = vec2{ has0 / w, has1 / w };
+    vec2 result = vec2{ has0 / c_tapWeights.total, has1 / c_tapWeights.total };
     //result = result * result;
     return result;
 }
 
-template <bool MAKE_BLUE_NOISE>
-void mainImage(float& fragColor, const vec2& fragCoord, const ivec2& sz, size_t iFrame, const std::vector<float>& oldNoise, size_t oldNoiseWidth)
+static const float c_chanceLimit = 0.5f;
+
+// the mask that pixels are xor'd with to find which pixel they are paired with this frame
+static ivec2 PairMask(const ivec2& sz, size_t iFrame)
 {
-    ivec2 p0 = ivec2{ int(fragCoord[0]),int(fragCoord[1]) };
     vec2 maskf = hash21(float(iFrame));
     int M = 60 * 60;
     int F = (iFrame % M);
     float framef = float(F) / float(M);
-    float chance_limit = 0.5f;
-    float force_limit = 1.0f - clamp(framef * 8.0f, 0.0f, 1.0f);
-    force_limit = force_limit * force_limit;
-    force_limit = force_limit * force_limit;/*
-    if (F == 0) {
-        int c = (p0[0] * 61 + p0[1]) % 256;
-        fragColor = float(c) / 255.0f;
+
+    vec2 temp = vec2{ float(sz[0]), float(sz[1]) } *maskf + vec2{ float(sz[0]), float(sz[1]) } *maskf * framef;
+
+    return ivec2{ int(temp[0]), int(temp[1]) };
+}
+
+// Each pixel p0 is paired with p1 = p0 ^ mask, and the pair either swaps values or doesn't. The decision is the same when
+// evaluated from either side of the pair, so it's only evaluated by the pixel with the lower index, which writes both pixels.
+template <bool MAKE_BLUE_NOISE>
+void mainImage(std::vector<float>& newNoise, const ivec2& p0, const ivec2& sz, const ivec2& mask, size_t iFrame, const std::vector<float>& oldNoise, size_t oldNoiseWidth)
+{
+    ivec2 p1 = (p0 ^ mask) % sz;
+    ivec2 pp0 = (p1 ^ mask) % sz;
+
+    size_t index0 = p0[1] * oldNoiseWidth + p0[0];
+    size_t index1 = p1[1] * oldNoiseWidth + p1[0];
+
+    float v0 = oldNoise[index0];
+
+    // if the pairing isn't mutual, or the pixel is paired with itself, the pixel keeps its value
+    if (pp0 != p0 || index0 == index1)
+    {
+        newNoise[index0] = v0;
+        return;
+    }
+
+    // the other pixel in the pair handles it
+    if (index0 > index1)
+        return;
+
+    float chance0 = hash13(vec3{ float(p0[0]), float(p0[1]), float(iFrame) });
+    float chance1 = hash13(vec3{ float(p1[0]), float(p1[1]), float(iFrame) });
+    float chance = max(chance0, chance1);
+
+    float v1 = oldNoise[index1];
+
+    vec2 s0_x0 = quantify_error(oldNoise, oldNoiseWidth, p0, sz, v0, v1);
+    vec2 s1_x1 = quantify_error(oldNoise, oldNoiseWidth, p1, sz, v1, v0);
+
+    float err_s = s0_x0[0] + s1_x1[0];
+    float err_x = s0_x0[1] + s1_x1[1];
+
+    bool swap = MAKE_BLUE_NOISE
+        ? ((chance < c_chanceLimit) && (err_x < err_s))
+        : ((chance < c_chanceLimit) && (err_x > err_s));
+
+    newNoise[index0] = swap ? v1 : v0;
+    newNoise[index1] = swap ? v0 : v1;
+}
+
+#if PANIQ_SIMD()
+
+// The SIMD version splits a frame into two passes so that it can work on rows of adjacent pixels at once.
+// The first pass calculates quantify_error() and the hash for every pixel, 8 pixels at a time, reading the neighborhood from a
+// copy of the noise padded with wrapped around pixels so that every tap is a contiguous load.
+// The second pass makes the swap decision for each pixel using its own values and the values of the pixel it's paired with.
+// It does the same floating point operations in the same order as the scalar version, so gives identical results.
+
+static const int c_simdLanes = 8;
+static const int c_padding = R2 / 2;
+
+struct PaniqScratch
+{
+    std::vector<float> paddedNoise;
+    std::vector<float> has0;
+    std::vector<float> has1;
+    std::vector<float> chance;
+    std::vector<int> partner; // the index of the pixel this pixel is paired with, or -1 if it keeps its value
+};
+
+// same as fract() for non negative values
+static inline __m128 fract_sse(__m128 x)
+{
+    return _mm_sub_ps(x, _mm_cvtepi32_ps(_mm_cvttps_epi32(x)));
+}
+
+// hash13() for 4 lanes at once
+static inline __m128 hash13_sse(__m128 x, __m128 y, __m128 z)
+{
+    const __m128 c_scale = _mm_set1_ps(0.1031f);
+    const __m128 c_offset = _mm_set1_ps(19.19f);
+
+    x = fract_sse(_mm_mul_ps(x, c_scale));
+    y = fract_sse(_mm_mul_ps(y, c_scale));
+    z = fract_sse(_mm_mul_ps(z, c_scale));
+
+    __m128 d = _mm_mul_ps(x, _mm_add_ps(y, c_offset));
+    d = _mm_add_ps(d, _mm_mul_ps(y, _mm_add_ps(z, c_offset)));
+    d = _mm_add_ps(d, _mm_mul_ps(z, _mm_add_ps(x, c_offset)));
+
+    x = _mm_add_ps(x, d);
+    y = _mm_add_ps(y, d);
+    z = _mm_add_ps(z, d);
+
+    return fract_sse(_mm_mul_ps(_mm_add_ps(x, y), z));
+}
+
+// quantify_error() for 8 adjacent pixels at once. paddedNoise points at the first pixel in the padded noise.
+static void QuantifyErrorSIMD(const float* paddedNoise, const int* tapOffsets, const float* val0, const float* val1, float* has0Out, float* has1Out)
+{
+    const __m128 c_one = _mm_set1_ps(1.0f);
+    const __m128 c_absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    __m128 val0A = _mm_loadu_ps(&val0[0]);
+    __m128 val0B = _mm_loadu_ps(&val0[4]);
+    __m128 val1A = _mm_loadu_ps(&val1[0]);
+    __m128 val1B = _mm_loadu_ps(&val1[4]);
+
+    __m128 has0A = _mm_setzero_ps();
+    __m128 has0B = _mm_setzero_ps();
+    __m128 has1A = _mm_setzero_ps();
+    __m128 has1B = _mm_setzero_ps();
+
+    for (int tap = 0; tap < c_tapCount; ++tap)
+    {
+        const float* src = &paddedNoise[tapOffsets[tap]];
+        __m128 vA = _mm_loadu_ps(&src[0]);
+        __m128 vB = _mm_loadu_ps(&src[4]);
+        __m128 q = _mm_set1_ps(c_tapWeights.weight[tap]);
+
+        __m128 dist0A = _mm_and_ps(_mm_sub_ps(vA, val0A), c_absMask);
+        __m128 dist0B = _mm_and_ps(_mm_sub_ps(vB, val0B), c_absMask);
+        __m128 dist1A = _mm_and_ps(_mm_sub_ps(vA, val1A), c_absMask);
+        __m128 dist1B = _mm_and_ps(_mm_sub_ps(vB, val1B), c_absMask);
+
+        has0A = _mm_add_ps(has0A, _mm_mul_ps(_mm_sub_ps(c_one, dist0A), q));
+        has0B = _mm_add_ps(has0B, _mm_mul_ps(_mm_sub_ps(c_one, dist0B), q));
+        has1A = _mm_add_ps(has1A, _mm_mul_ps(_mm_sub_ps(c_one, dist1A), q));
+        has1B = _mm_add_ps(has1B, _mm_mul_ps(_mm_sub_ps(c_one, dist1B), q));
     }
-    else*/ {
-        vec2 temp = vec2{ float(sz[0]), float(sz[1]) } *maskf + vec2{ float(sz[0]), float(sz[1]) } *maskf * framef;
 
-        ivec2 mask = ivec2{ int(temp[0]), int(temp[1]) };
-        ivec2 p1 = (p0 ^ mask) % sz;
-        ivec2 pp0 = (p1 ^ mask) % sz;
+    const __m128 total = _mm_set1_ps(c_tapWeights.total);
+    _mm_storeu_ps(&has0Out[0], _mm_div_ps(has0A, total));
+    _mm_storeu_ps(&has0Out[4], _mm_div_ps(has0B, total));
+    _mm_storeu_ps(&has1Out[0], _mm_div_ps(has1A, total));
+    _mm_storeu_ps(&has1Out[4], _mm_div_ps(has1B, total));
+}
 
-        float chance0 = hash13(vec3{ float(p0[0]), float(p0[1]), float(iFrame) });
-        float chance1 = hash13(vec3{ float(p1[0]), float(p1[1]), float(iFrame) });
-        float chance = max(chance0, chance1);
+template <bool MAKE_BLUE_NOISE>
+static void PaniqFrameSIMD(std::vector<float>& newNoise, const std::vector<float>& oldNoise, size_t width, size_t height, size_t iFrame, PaniqScratch& scratch)
+{
+    const ivec2 sz = ivec2{ int(width), int(height) };
+    const ivec2 mask = PairMask(sz, iFrame);
+    const int paddedWidth = int(width) + c_padding * 2;
+    const int paddedHeight = int(height) + c_padding * 2;
 
-        float v0 = oldNoise[p0[1] * oldNoiseWidth + p0[0]];
-        float v1 = oldNoise[p1[1] * oldNoiseWidth + p1[0]];
+    // make the padded copy of the noise
+    scratch.paddedNoise.resize(paddedWidth * paddedHeight);
+    #pragma omp parallel for
+    for (int iy = 0; iy < paddedHeight; ++iy)
+    {
+        int srcY = ((iy - c_padding) % int(height) + int(height)) % int(height);
+        float* dest = &scratch.paddedNoise[iy * paddedWidth];
+        for (int ix = 0; ix < paddedWidth; ++ix)
+        {
+            int srcX = ((ix - c_padding) % int(width) + int(width)) % int(width);
+            dest[ix] = oldNoise[srcY * width + srcX];
+        }
+    }
 
-        vec2 s0_x0 = quantify_error(oldNoise, oldNoiseWidth, p0, sz, v0, v1);
-        vec2 s1_x1 = quantify_error(oldNoise, oldNoiseWidth, p1, sz, v1, v0);
+    // the offset of each tap in the padded noise
+    int tapOffsets[c_tapCount];
+    for (int tap = 0; tap < c_tapCount; ++tap)
+        tapOffsets[tap] = c_taps.offsetY[tap] * paddedWidth + c_taps.offsetX[tap];
 
-        float err_s = s0_x0[0] + s1_x1[0];
-        float err_x = s0_x0[1] + s1_x1[1];
+    scratch.has0.resize(width*height);
+    scratch.has1.resize(width*height);
+    scratch.chance.resize(width*height);
+    scratch.partner.resize(width*height);
 
-        float p = v0;
-        if (pp0 == p0) {
+    // pass 1: quantify error and hash for every pixel
+    #pragma omp parallel for
+    for (int iy = 0; iy < int(height); ++iy)
+    {
+        float partnerValues[c_simdLanes];
 
-            if (MAKE_BLUE_NOISE)
+        int ix = 0;
+        for (; ix < int(width); ix += c_simdLanes)
+        {
+            int laneCount = std::min(c_simdLanes, int(width) - ix);
+            size_t rowIndex = iy * width + ix;
+
+            // find the pixels that these pixels are paired with
+            for (int lane = 0; lane < laneCount; ++lane)
             {
-                if (/*(chance < force_limit) ||*/ ((chance < chance_limit) && (err_x < err_s))) {
-                    p = v1;
-                }
+                ivec2 p0 = ivec2{ ix + lane, iy };
+                ivec2 p1 = (p0 ^ mask) % sz;
+                ivec2 pp0 = (p1 ^ mask) % sz;
+
+                int index0 = p0[1] * int(width) + p0[0];
+                int index1 = p1[1] * int(width) + p1[0];
+
+                scratch.partner[index0] = (pp0 != p0 || index0 == index1) ? -1 : index1;
+                partnerValues[lane] = oldNoise[index1];
+            }
+
+            if (laneCount == c_simdLanes)
+            {
+                const float* paddedNoise = &scratch.paddedNoise[(iy + c_padding) * paddedWidth + ix + c_padding];
+                QuantifyErrorSIMD(paddedNoise, tapOffsets, &oldNoise[rowIndex], partnerValues, &scratch.has0[rowIndex], &scratch.has1[rowIndex]);
+
+                __m128 y = _mm_set1_ps(float(iy));
+                __m128 z = _mm_set1_ps(float(iFrame));
+                _mm_storeu_ps(&scratch.chance[rowIndex + 0], hash13_sse(_mm_setr_ps(float(ix + 0), float(ix + 1), float(ix + 2), float(ix + 3)), y, z));
+                _mm_storeu_ps(&scratch.chance[rowIndex + 4], hash13_sse(_mm_setr_ps(float(ix + 4), float(ix + 5), float(ix + 6), float(ix + 7)), y, z));
             }
             else
             {
-                if (/*(chance < force_limit) ||*/ ((chance < chance_limit) && (err_x > err_s))) {
-                    p = v1;
+                // the pixels left over at the end of the row are done one at a time
+                for (int lane = 0; lane < laneCount; ++lane)
+                {
+                    vec2 s = quantify_error(oldNoise, width, ivec2{ ix + lane, iy }, sz, oldNoise[rowIndex + lane], partnerValues[lane]);
+                    scratch.has0[rowIndex + lane] = s[0];
+                    scratch.has1[rowIndex + lane] = s[1];
+                    scratch.chance[rowIndex + lane] = hash13(vec3{ float(ix + lane), float(iy), float(iFrame) });
                 }
             }
         }
-        fragColor = p;
+    }
+
+    // pass 2: decide whether each pair swaps
+    #pragma omp parallel for
+    for (int iy = 0; iy < int(height); ++iy)
+    {
+        for (size_t ix = 0; ix < width; ++ix)
+        {
+            size_t index0 = iy * width + ix;
+            int index1 = scratch.partner[index0];
+
+            if (index1 < 0)
+            {
+                newNoise[index0] = oldNoise[index0];
+                continue;
+            }
+
+            float chance = max(scratch.chance[index0], scratch.chance[index1]);
+            float err_s = scratch.has0[index0] + scratch.has0[index1];
+            float err_x = scratch.has1[index0] + scratch.has1[index1];
+
+            bool swap = MAKE_BLUE_NOISE
+                ? ((chance < c_chanceLimit) && (err_x < err_s))
+                : ((chance < c_chanceLimit) && (err_x > err_s));
+
+            newNoise[index0] = swap ? oldNoise[index1] : oldNoise[index0];
+        }
     }
 }
 
+#endif
+
 void GenerateBN_Paniq(
     std::vector<uint8_t>& blueNoise,
     size_t width,
+    size_t height,
     size_t iterations,
     bool makeBlueNoise
 )
@@ -130,35 +402,81 @@ void GenerateBN_Paniq(
     // start with some white noise
     std::mt19937 rng(GetRNGSeed());
     std::vector<float> noise, noise2;
-    MakeWhiteNoiseFloat(rng, noise, width);
+    MakeWhiteNoiseFloat(rng, noise, width, height);
     noise2 = noise;
 
+    // or pick up where an earlier run left off, if there is a checkpoint. Each frame writes every pixel of noise2 from noise,
+    // so noise2 and the frame index are all of the state.
+    char params[256];
+    sprintf(params, "iterations=%zu;blue=%i", iterations, makeBlueNoise ? 1 : 0);
+    Checkpoint checkpoint("paniq", width, height, params);
+    uint64_t firstIteration = 0;
+    if (checkpoint.Load())
+    {
+        std::vector<float> savedNoise;
+        checkpoint.Read(firstIteration);
+        checkpoint.ReadVector(savedNoise);
+        if (checkpoint.FinishLoad() && savedNoise.size() == width * height)
+        {
+            noise2 = savedNoise;
+            noise = savedNoise;
+        }
+        else
+        {
+            printf("Checkpoint is damaged, ignoring it\n");
+            firstIteration = 0;
+        }
+    }
+
+#if PANIQ_SIMD()
+    PaniqScratch scratch;
+#endif
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
     // do multiple iterations of this: reading from noise and writing to noise2
-    for (size_t iteration = 0; iteration < iterations; ++iteration)
+    for (size_t iteration = size_t(firstIteration); iteration < iterations; ++iteration)
     {
         printf("\r%i%%", int(100.0f*float(iteration) / float(iterations)));
 
         // each iteration, swap them because what was previously the better noise is now the lesser noise compared to the next iteration noise
         std::swap(noise, noise2);
 
-        // run the pixel shader per pixel
+#if PANIQ_SIMD()
+        if (makeBlueNoise)
+            PaniqFrameSIMD<true>(noise2, noise, width, height, iteration, scratch);
+        else
+            PaniqFrameSIMD<false>(noise2, noise, width, height, iteration, scratch);
+#else
+        const ivec2 sz = ivec2{ int(width), int(height) };
+        const ivec2 mask = PairMask(sz, iteration);
+
+        // run the pixel shader per pixel. Pixels may write to their pair in another row, but every pixel is written exactly once.
         #pragma omp parallel for
-        for (int iy = 0; iy < width; ++iy)
+        for (int iy = 0; iy < height; ++iy)
         {
-            float* dest = &noise2[iy*width];
-
             for (size_t ix = 0; ix < width; ++ix)
             {
-                float pixelOut;
                 if(makeBlueNoise)
-                    mainImage<true>(pixelOut, vec2{ float(ix), float(iy) }, ivec2{ int(width), int(width) }, iteration, noise, width);
+                    mainImage<true>(noise2, ivec2{ int(ix), iy }, sz, mask, iteration, noise, width);
                 else
-                    mainImage<false>(pixelOut, vec2{ float(ix), float(iy) }, ivec2{ int(width), int(width) }, iteration, noise, width);
-                dest[ix] = pixelOut;
+                    mainImage<false>(noise2, ivec2{ int(ix), iy }, sz, mask, iteration, noise, width);
             }
         }
+#endif
+
+        if (checkpoint.Due())
+        {
+            checkpoint.Write(uint64_t(iteration + 1));
+            checkpoint.WriteVector(noise2);
+            checkpoint.Save();
+        }
     }
-    printf("\n");
+    checkpoint.Remove();
+
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    printf("\r%zux%zu: %0.2f frames per second\n", width, height, double(iterations - size_t(firstIteration)) / seconds);
 
     // convert from float to U8 into the blue noise array
     FromFloat(noise2, blueNoise);
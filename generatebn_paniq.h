@@ -4,9 +4,11 @@
 
 // CPU implementation of his shadertoy, inspired by the swapping paper.
 // https://www.shadertoy.com/view/XtdyW2
+// CHECKPOINT() in settings.h lets a long run be stopped and continued later.
 void GenerateBN_Paniq(
     std::vector<uint8_t>& blueNoise,
     size_t width,
+    size_t height,
     size_t iterations,
     bool makeBlueNoise // if false, makes red noise
 );
\ No newline at end of file
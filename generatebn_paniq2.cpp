@@ -2,6 +2,10 @@
 #include "vec.h"
 #include "convert.h"
 
+#include <algorithm>
+#include <emmintrin.h>
+#include <stdio.h>
+
 #define LEVEL 15U
 #define WIDTH ( (1U << LEVEL) )
 #define AREA ( WIDTH * WIDTH )
@@ -19,40 +23,113 @@ uint pack_morton2x16(uvec2 v) {
     return part1by1(v[0]) | (part1by1(v[1]) << 1);
 }
 
+// The number of levels needed for a width x width image
+static uint HilbertLevels(size_t width)
+{
+    uint levels = 0;
+    while ((size_t(1) << levels) < width)
+        levels++;
+    return levels;
+}
+
 // from https://www.shadertoy.com/view/XtGBDW
+// The shadertoy always starts at level WIDTH/2. The levels above the image size always have a region of 0, which only swaps x and y,
+// so they are skipped, and x and y are swapped once up front if there were an odd number of them. This gives the same result.
 uint HilbertIndex(uvec2 Position, size_t width)
 {
+    uint levels = HilbertLevels(width);
+    uint x = Position[0];
+    uint y = Position[1];
+    if (levels < LEVEL && ((LEVEL - levels) & 1U))
+        std::swap(x, y);
+
+    const uint flipMask = uint(width - 1);
+
     uint Index = 0U;
-    for (uint CurLevel = WIDTH / 2U; CurLevel > 0U; CurLevel /= 2U)
+    for (uint level = levels; level-- > 0U; )
     {
-        uvec2 Region = uvec2(greaterThan((Position & uvec2{ CurLevel, CurLevel }), uvec2{ 0, 0 }));
-        Index += CurLevel * CurLevel * ((3U * Region[0]) ^ Region[1]);
-        if (Region[1] == 0U)
+        uint rx = (x >> level) & 1U;
+        uint ry = (y >> level) & 1U;
+        Index += ((3U * rx) ^ ry) << (2U * level);
+        if (ry == 0U)
         {
-            if (Region[0] == 1U)
+            if (rx == 1U)
             {
-                Position = uvec2{ uint(width - 1), uint(width - 1) } - Position;
+                x = flipMask - x;
+                y = flipMask - y;
             }
-            std::swap(Position[0], Position[1]);
+            std::swap(x, y);
         }
     }
 
     return Index;
 }
 
-float mainImage(vec2 fragCoord, vec2 iResolution)
+// HilbertIndex() for 4 adjacent pixels in a row at once
+static __m128i HilbertIndex_sse(uint x0, uint y0, size_t width)
 {
-    vec2 uv = fragCoord / iResolution;
-#if 1
-    uint x = HilbertIndex(uvec2{ uint(fragCoord[0]), uint(fragCoord[1]) }, size_t(iResolution[0])) % (1u << 17u);
-#else
-    uint x = pack_morton2x16(uvec2{ fragCoord[0], fragCoord[1] }) % (1u << 17u);
-#endif
+    uint levels = HilbertLevels(width);
+    __m128i x = _mm_setr_epi32(int(x0), int(x0 + 1), int(x0 + 2), int(x0 + 3));
+    __m128i y = _mm_set1_epi32(int(y0));
+    if (levels < LEVEL && ((LEVEL - levels) & 1U))
+        std::swap(x, y);
+
+    const __m128i flipMask = _mm_set1_epi32(int(width - 1));
+    const __m128i allOnes = _mm_set1_epi32(-1);
+    const __m128i three = _mm_set1_epi32(3);
+    const __m128i one = _mm_set1_epi32(1);
+
+    __m128i index = _mm_setzero_si128();
+    for (uint level = levels; level-- > 0U; )
+    {
+        __m128i bit = _mm_set1_epi32(int(1U << level));
+        __m128i rx = _mm_cmpeq_epi32(_mm_and_si128(x, bit), bit);
+        __m128i ry = _mm_cmpeq_epi32(_mm_and_si128(y, bit), bit);
+
+        __m128i region = _mm_xor_si128(_mm_and_si128(rx, three), _mm_and_si128(ry, one));
+        index = _mm_add_epi32(index, _mm_sll_epi32(region, _mm_cvtsi32_si128(int(2U * level))));
+
+        // flip where ry is 0 and rx is 1
+        __m128i flip = _mm_andnot_si128(ry, rx);
+        __m128i flippedX = _mm_sub_epi32(flipMask, x);
+        __m128i flippedY = _mm_sub_epi32(flipMask, y);
+        x = _mm_or_si128(_mm_and_si128(flip, flippedX), _mm_andnot_si128(flip, x));
+        y = _mm_or_si128(_mm_and_si128(flip, flippedY), _mm_andnot_si128(flip, y));
+
+        // swap where ry is 0
+        __m128i swap = _mm_xor_si128(ry, allOnes);
+        __m128i newX = _mm_or_si128(_mm_and_si128(swap, y), _mm_andnot_si128(swap, x));
+        __m128i newY = _mm_or_si128(_mm_and_si128(swap, x), _mm_andnot_si128(swap, y));
+        x = newX;
+        y = newY;
+    }
+
+    return index;
+}
+
+// part1by1() for 4 lanes at once
+static __m128i part1by1_sse(__m128i x)
+{
+    x = _mm_and_si128(x, _mm_set1_epi32(0x0000ffff));
+    x = _mm_and_si128(_mm_xor_si128(x, _mm_slli_epi32(x, 8)), _mm_set1_epi32(0x00ff00ff));
+    x = _mm_and_si128(_mm_xor_si128(x, _mm_slli_epi32(x, 4)), _mm_set1_epi32(0x0f0f0f0f));
+    x = _mm_and_si128(_mm_xor_si128(x, _mm_slli_epi32(x, 2)), _mm_set1_epi32(0x33333333));
+    x = _mm_and_si128(_mm_xor_si128(x, _mm_slli_epi32(x, 1)), _mm_set1_epi32(0x55555555));
+    return x;
+}
+
+float mainImage(vec2 fragCoord, vec2 iResolution, Paniq2Curve curve)
+{
+    uvec2 pixel = uvec2{ uint(fragCoord[0]), uint(fragCoord[1]) };
+    uint x = (curve == Paniq2Curve::Hilbert)
+        ? HilbertIndex(pixel, size_t(iResolution[0])) % (1u << 17u)
+        : pack_morton2x16(pixel) % (1u << 17u);
 
     float phi = 2.0f / (sqrt(5.0f) + 1.0f);
     float c = fract(0.5f + phi * float(x));
 
     /*
+    vec2 uv = fragCoord / iResolution;
     if (uv[0] > 0.5) {
         c = step(c, uv[1]);
     }
@@ -61,21 +138,137 @@ float mainImage(vec2 fragCoord, vec2 iResolution)
     return c;
 }
 
+// mainImage() for 4 adjacent pixels in a row at once
+static __m128 mainImage_sse(uint x0, uint y, size_t curveWidth, Paniq2Curve curve)
+{
+    __m128i index = (curve == Paniq2Curve::Hilbert)
+        ? HilbertIndex_sse(x0, y, curveWidth)
+        : _mm_or_si128(part1by1_sse(_mm_setr_epi32(int(x0), int(x0 + 1), int(x0 + 2), int(x0 + 3))), _mm_slli_epi32(part1by1_sse(_mm_set1_epi32(int(y))), 1));
+    index = _mm_and_si128(index, _mm_set1_epi32((1 << 17) - 1));
+
+    // c = fract(0.5 + phi * float(index))
+    const float phi = 2.0f / (sqrt(5.0f) + 1.0f);
+    __m128 c = _mm_add_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_mm_set1_ps(phi), _mm_cvtepi32_ps(index)));
+    return _mm_sub_ps(c, _mm_cvtepi32_ps(_mm_cvttps_epi32(c)));
+}
+
+// A rectangle is cut out of the curve of the square that encloses it, so a square gives the same noise as before
+static size_t CurveWidth(size_t width, size_t height)
+{
+    return std::max(width, height);
+}
+
+float Paniq2Sample(size_t x, size_t y, size_t width, size_t height, Paniq2Curve curve)
+{
+    const float curveWidth = float(CurveWidth(width, height));
+    return mainImage(vec2{ float(x % width), float(y % height) }, vec2{ curveWidth, curveWidth }, curve);
+}
+
+// Calls writeLanes(destIndex, values) for groups of 4 pixels that don't cross the right edge of the texture,
+// and writeOne(destIndex, value) for the rest.
+template <typename TWRITELANES, typename TWRITEONE>
+static void SampleSpan(size_t y, size_t x0, size_t count, size_t width, size_t height, Paniq2Curve curve, const TWRITELANES& writeLanes, const TWRITEONE& writeOne)
+{
+    const size_t curveWidth = CurveWidth(width, height);
+    y = y % height;
+    size_t i = 0;
+    while (i < count)
+    {
+        size_t x = (x0 + i) % width;
+        if (x + 4 <= width && i + 4 <= count)
+        {
+            writeLanes(i, mainImage_sse(uint(x), uint(y), curveWidth, curve));
+            i += 4;
+        }
+        else
+        {
+            writeOne(i, mainImage(vec2{ float(x), float(y) }, vec2{ float(curveWidth), float(curveWidth) }, curve));
+            i++;
+        }
+    }
+}
+
+void Paniq2SampleSpan(size_t y, size_t x0, size_t count, size_t width, size_t height, float* out, Paniq2Curve curve)
+{
+    SampleSpan(y, x0, count, width, height, curve,
+        [out](size_t index, __m128 values)
+        {
+            _mm_storeu_ps(&out[index], values);
+        },
+        [out](size_t index, float value)
+        {
+            out[index] = value;
+        }
+    );
+}
+
+void Paniq2SampleSpan(size_t y, size_t x0, size_t count, size_t width, size_t height, uint8_t* out, Paniq2Curve curve)
+{
+    SampleSpan(y, x0, count, width, height, curve,
+        [out](size_t index, __m128 values)
+        {
+            // converted to U8 the same way as FromFloat<uint8_t>()
+            __m128i value = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(values, _mm_set1_ps(256.0f)), _mm_set1_ps(255.0f)));
+            alignas(16) int lanes[4];
+            _mm_store_si128((__m128i*)lanes, value);
+            for (int lane = 0; lane < 4; ++lane)
+                out[index + lane] = uint8_t(lanes[lane]);
+        },
+        [out](size_t index, float value)
+        {
+            out[index] = FromFloat<uint8_t>(value);
+        }
+    );
+}
+
 void GenerateBN_Paniq2(
     std::vector<uint8_t>& blueNoise,
-    size_t width
+    size_t width,
+    size_t height,
+    Paniq2Curve curve
+)
+{
+    blueNoise.resize(width*height);
+
+    #pragma omp parallel for
+    for (int y = 0; y < int(height); ++y)
+        Paniq2SampleSpan(y, 0, width, width, height, &blueNoise[y*width], curve);
+}
+
+bool GenerateBN_Paniq2_Streamed(
+    size_t width,
+    size_t height,
+    size_t tileHeight,
+    const char* fileName,
+    Paniq2Curve curve
 )
 {
-    blueNoise.resize(width*width);
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "wb");
+    if (!file)
+        return false;
+
+    // binary PGM header, followed by the rows of pixels
+    fprintf(file, "P5\n%zu %zu\n255\n", width, height);
 
-    for (size_t y = 0; y < width; ++y)
+    std::vector<uint8_t> tile(width * tileHeight);
+    bool success = true;
+    for (size_t tileY = 0; tileY < height && success; tileY += tileHeight)
     {
-        for (size_t x = 0; x < width; ++x)
-        {
-            float value = mainImage(vec2{ float(x), float(y) }, vec2{ float(width), float(width) });
-            blueNoise[y*width + x] = FromFloat<uint8_t>(value);
-        }
+        printf("\r%i%%", int(100.0f * float(tileY) / float(height)));
+
+        size_t rows = std::min(tileHeight, height - tileY);
+
+        #pragma omp parallel for
+        for (int row = 0; row < int(rows); ++row)
+            Paniq2SampleSpan(tileY + row, 0, width, width, height, &tile[row * width], curve);
+
+        success = fwrite(tile.data(), 1, rows * width, file) == rows * width;
     }
+    printf("\n");
+
+    fclose(file);
+    return success;
 }
 
 // NOTE: animating it? weird results... https://twitter.com/R4_Unit/status/1141138019488944129?s=03
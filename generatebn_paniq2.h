@@ -1,10 +1,41 @@
 #pragma once
 
+#include <stdint.h>
 #include <vector>
 
+// which curve the R1 sequence is laid out along
+enum class Paniq2Curve
+{
+    Hilbert,
+    Morton
+};
+
 // CPU implementation of his shadertoy, uses Martin Roberts R1 sequence on a hilbert curve
 // https://www.shadertoy.com/view/3tB3z3
+// Rectangles are cut out of the curve of the max(width, height) square, so they don't tile as well as squares do.
 void GenerateBN_Paniq2(
     std::vector<uint8_t>& blueNoise,
-    size_t width
-);
\ No newline at end of file
+    size_t width,
+    size_t height,
+    Paniq2Curve curve = Paniq2Curve::Hilbert
+);
+
+// Same as GenerateBN_Paniq2, but writes the noise to a binary PGM file, tileHeight rows at a time, so that only
+// width*tileHeight pixels are in memory at once. Useful for 16k x 16k and larger textures. Returns false on file errors.
+bool GenerateBN_Paniq2_Streamed(
+    size_t width,
+    size_t height,
+    size_t tileHeight,
+    const char* fileName,
+    Paniq2Curve curve = Paniq2Curve::Hilbert
+);
+
+// The paniq2 noise is a pure function of the pixel location and texture size, so it can be sampled directly instead of
+// making a texture and reading from it. Locations outside of the texture wrap around, so it tiles.
+// Returns pixel (x,y) of a width x height paniq2 texture, from 0 to 1.
+float Paniq2Sample(size_t x, size_t y, size_t width, size_t height, Paniq2Curve curve = Paniq2Curve::Hilbert);
+
+// Writes count pixels of row y, starting at x0, to out. Uses SSE2 to do 4 pixels at a time.
+// The U8 version gives the same values as GenerateBN_Paniq2.
+void Paniq2SampleSpan(size_t y, size_t x0, size_t count, size_t width, size_t height, float* out, Paniq2Curve curve = Paniq2Curve::Hilbert);
+void Paniq2SampleSpan(size_t y, size_t x0, size_t count, size_t width, size_t height, uint8_t* out, Paniq2Curve curve = Paniq2Curve::Hilbert);
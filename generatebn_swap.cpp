@@ -1,8 +1,14 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <algorithm>
+
+#include "checkpoint.h"
 #include "convert.h"
 #include "generatebn_swap.h"
+#include "output.h"
 #include "whitenoise.h"
 
-inline float ToroidalDistanceSquared(float x1, float y1, float x2, float y2, float width)
+inline float ToroidalDistanceSquared(float x1, float y1, float x2, float y2, float width, float height)
 {
     float dx = std::abs(x2 - x1);
     float dy = std::abs(y2 - y1);
@@ -10,26 +16,27 @@ inline float ToroidalDistanceSquared(float x1, float y1, float x2, float y2, flo
     if (dx > 0.5f * width)
         dx = width - dx;
 
-    if (dy > 0.5f * width)
-        dy = width - dy;
+    if (dy > 0.5f * height)
+        dy = height - dy;
 
     return (dx * dx + dy * dy);
 }
 
 template <bool LIMITTO3SIGMA>
-float CalculateEnergy(const std::vector<float>& pixels, size_t width)
+float CalculateEnergy(const std::vector<float>& pixels, size_t width, size_t height)
 {
     static const float c_sigma_i = 2.1f;
     static const float c_sigma_s = 1.0f;
 
-    static const int c_3Sigma_i = int(Clamp<size_t>(0, width / 2 - 1, size_t(ceil(c_sigma_i*3.0f))));
+    // the window can't be wider than half of the shorter axis, or it would count pixels twice after wrapping around
+    const int c_3Sigma_i = int(Clamp<size_t>(0, std::min(width, height) / 2 - 1, size_t(ceil(c_sigma_i*3.0f))));
 
-    size_t pixelCount = width * width;
+    size_t pixelCount = width * height;
  
     // process rows until we run out
-    std::vector<float> energies(width, 0.0f);
+    std::vector<float> energies(height, 0.0f);
     #pragma omp parallel for
-    for (int row = 0; row < width; ++row)
+    for (int row = 0; row < height; ++row)
     {
         // for each pixel in this row...
         for (size_t column = 0; column < width; ++column)
@@ -49,8 +56,8 @@ float CalculateEnergy(const std::vector<float>& pixels, size_t width)
 
                     int qyi = int(qy);
                     if (qyi < 0)
-                        qyi += int(width);
-                    qyi = qyi % width;
+                        qyi += int(height);
+                    qyi = qyi % height;
 
                     for (int ox = -c_3Sigma_i; ox <= c_3Sigma_i; ++ox)
                     {
@@ -63,7 +70,7 @@ float CalculateEnergy(const std::vector<float>& pixels, size_t width)
 
                         float qvalue = pixels[qyi*width + qxi];
 
-                        float distanceSquared = ToroidalDistanceSquared(px, py, qx, qy, float(width));
+                        float distanceSquared = ToroidalDistanceSquared(px, py, qx, qy, float(width), float(height));
 
                         float leftTerm = (distanceSquared) / (c_sigma_i * c_sigma_i);
 
@@ -88,7 +95,7 @@ float CalculateEnergy(const std::vector<float>& pixels, size_t width)
                     float qy = float(q / width);
                     float qvalue = pixels[q];
 
-                    float distanceSquared = ToroidalDistanceSquared(px, py, qx, qy, float(width));
+                    float distanceSquared = ToroidalDistanceSquared(px, py, qx, qy, float(width), float(height));
 
                     float leftTerm = (distanceSquared) / (c_sigma_i * c_sigma_i);
 
@@ -114,6 +121,7 @@ float CalculateEnergy(const std::vector<float>& pixels, size_t width)
 void GenerateBN_Swap(
     std::vector<uint8_t>& pixels,
     size_t width,
+    size_t height,
     size_t swapTries,
     const char* csvFileName,
     bool limitTo3Sigma,
@@ -123,34 +131,66 @@ void GenerateBN_Swap(
     bool minimizeEnergy
 )
 {
-    std::uniform_int_distribution<size_t> dist(0, width*width - 1);
+    std::uniform_int_distribution<size_t> dist(0, width*height - 1);
     std::uniform_real_distribution<float> distFloat(0.0f, 1.0f);
 
     std::uniform_int_distribution<int> distSwapCount(1, numSimultaneousSwaps_);
 
-    FILE* file = nullptr;
-    if(csvFileName)
-        fopen_s(&file, csvFileName, "w+t");
+    // the csv is built up in memory and written by the output queue at the end
+    std::string csv;
 
-    // make white noisen and calculate the energy
     std::mt19937 rng(GetRNGSeed());
     std::vector<float> pixelsFloat;
-    MakeWhiteNoiseFloat(rng, pixelsFloat, width);
-    float pixelsEnergy = limitTo3Sigma ? CalculateEnergy<true>(pixelsFloat, width) : CalculateEnergy<false>(pixelsFloat, width);
-
-    float simulationTemperature = 1.0f *  simulatedAnnealingCoolingMultiplier;
-
-    if (file)
+    std::vector<float> pixelsCopy;
+    float pixelsEnergy = 0.0f;
+    float simulationTemperature = 0.0f;
+    uint64_t firstSwapTry = 0;
+
+    // pick up where an earlier run left off, if there is a checkpoint.
+    // The copy is saved too, since after a swap is taken it holds the pixels from before the swap, not the current pixels.
+    char params[256];
+    sprintf(params, "tries=%zu;limit3sigma=%i;cooling=%f;swaps=%i;metropolis=%i;minimize=%i", swapTries, limitTo3Sigma ? 1 : 0, simulatedAnnealingCoolingMultiplier, numSimultaneousSwaps_, useMetropolis ? 1 : 0, minimizeEnergy ? 1 : 0);
+    Checkpoint checkpoint("swap", width, height, params);
+    bool resumed = false;
+    if (checkpoint.Load())
     {
-        fprintf(file, "\"Step\",\"Energy\",\"Temperature\"\n");
-        fprintf(file, "\"-1\",\"%f\",\"%f\"\n", pixelsEnergy, simulationTemperature);
+        checkpoint.Read(firstSwapTry);
+        checkpoint.Read(pixelsEnergy);
+        checkpoint.Read(simulationTemperature);
+        checkpoint.ReadRNG(rng);
+        checkpoint.ReadVector(pixelsFloat);
+        checkpoint.ReadVector(pixelsCopy);
+        checkpoint.ReadString(csv);
+        resumed = checkpoint.FinishLoad() && pixelsFloat.size() == width * height && pixelsCopy.size() == width * height;
+        if (!resumed)
+        {
+            printf("Checkpoint is damaged, ignoring it\n");
+            rng = std::mt19937(GetRNGSeed());
+            csv.clear();
+            firstSwapTry = 0;
+        }
     }
 
-    // make a copy of the white noise
-    std::vector<float> pixelsCopy = pixelsFloat;
+    if (!resumed)
+    {
+        // make white noisen and calculate the energy
+        MakeWhiteNoiseFloat(rng, pixelsFloat, width, height);
+        pixelsEnergy = limitTo3Sigma ? CalculateEnergy<true>(pixelsFloat, width, height) : CalculateEnergy<false>(pixelsFloat, width, height);
+
+        simulationTemperature = 1.0f *  simulatedAnnealingCoolingMultiplier;
+
+        if (csvFileName)
+        {
+            AppendFormat(csv, "\"Step\",\"Energy\",\"Temperature\"\n");
+            AppendFormat(csv, "\"-1\",\"%f\",\"%f\"\n", pixelsEnergy, simulationTemperature);
+        }
+
+        // make a copy of the white noise
+        pixelsCopy = pixelsFloat;
+    }
 
     // do swaps to make it more blue
-    for (size_t swapTryCount = 0; swapTryCount < swapTries; ++swapTryCount)
+    for (size_t swapTryCount = size_t(firstSwapTry); swapTryCount < swapTries; ++swapTryCount)
     {
         simulationTemperature *= simulatedAnnealingCoolingMultiplier;
         printf("\r%zu / %zu", swapTryCount, swapTries);
@@ -168,7 +208,7 @@ void GenerateBN_Swap(
             std::swap(pixelsCopy[swaps[swapIndex * 2]], pixelsCopy[swaps[swapIndex * 2 + 1]]);
 
         // calculate the new energy
-        float newPixelsEnergy = limitTo3Sigma ? CalculateEnergy<true>(pixelsCopy, width) : CalculateEnergy<false>(pixelsCopy, width);
+        float newPixelsEnergy = limitTo3Sigma ? CalculateEnergy<true>(pixelsCopy, width, height) : CalculateEnergy<false>(pixelsCopy, width, height);
 
         bool passesTest = minimizeEnergy
             ? newPixelsEnergy < pixelsEnergy
@@ -197,12 +237,25 @@ void GenerateBN_Swap(
                 std::swap(pixelsCopy[swaps[swapIndex * 2]], pixelsCopy[swaps[swapIndex * 2 + 1]]);
         }
 
-        if (file)
-            fprintf(file, "\"%zu\",\"%f\",\"%f\"\n", swapTryCount, pixelsEnergy, simulationTemperature);
+        if (csvFileName)
+            AppendFormat(csv, "\"%zu\",\"%f\",\"%f\"\n", swapTryCount, pixelsEnergy, simulationTemperature);
+
+        if (checkpoint.Due())
+        {
+            checkpoint.Write(uint64_t(swapTryCount + 1));
+            checkpoint.Write(pixelsEnergy);
+            checkpoint.Write(simulationTemperature);
+            checkpoint.WriteRNG(rng);
+            checkpoint.WriteVector(pixelsFloat);
+            checkpoint.WriteVector(pixelsCopy);
+            checkpoint.WriteString(csv);
+            checkpoint.Save();
+        }
     }
+    checkpoint.Remove();
 
-    if (file)
-        fclose(file);
+    if (csvFileName)
+        GetOutputQueue().WriteText(csvFileName, std::move(csv));
 
     FromFloat(pixelsFloat, pixels);
     printf("\n");
@@ -4,9 +4,11 @@
 
 // generates blue noise by swapping white noise pixels that make it more blue
 // https://www.arnoldrenderer.com/research/dither_abstract.pdf
+// Can be checkpointed and resumed, see CHECKPOINT() in settings.h.
 void GenerateBN_Swap(
     std::vector<uint8_t>& blueNoise,
     size_t width,
+    size_t height,
     size_t swapTries,
     const char* csvFileName,
     bool limitTo3Sigma,
@@ -1,35 +1,103 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include "generatebn_void_cluster.h"
+#include "generatebn_hpf.h"
+#include "generatebn_paniq.h"
 #include "whitenoise.h"
 #include "convert.h"
-#include "stb/stb_image_write.h"
+#include "ranks.h"
+#include "output.h"
+#include "processmemory.h"
 #include "scoped_timer.h"
+#include "mappedfile.h"
+#include "checkpoint.h"
+#include "misc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <unordered_map>
 
 static const float c_sigma = 1.9f;// 1.5f;
 static const float c_2sigmaSquared = 2.0f * c_sigma * c_sigma;
 static const int c_3sigmaint = int(ceil(c_sigma * 3.0f));
 
-static void SaveLUTImage(const std::vector<bool>& binaryPattern, std::vector<float>& LUT, size_t width, const char* fileName)
+// The fixed point LUTs hold the energy scaled by 2^bits and rounded. Even if every pixel was a 1, the energy of a pixel would be
+// about 2 pi sigma^2 = 22.7, so 20 bits fits in an int32 with plenty of room, and 10 bits fits in an int16.
+// The 16 bit LUT halves the memory and bandwidth of the LUT, but the kernel rounds to 0 sooner and there are more ties.
+template <typename T>
+static int FixedPointBits();
+
+template <>
+int FixedPointBits<int32_t>()
+{
+    return 20;
+}
+
+template <>
+int FixedPointBits<int16_t>()
+{
+    return 10;
+}
+
+static const int c_maxFixedPointDiameter = 64;
+
+// The energy of a point at each distance, in fixed point. Past radius it rounds to 0, so points only need to be written that far out.
+struct FixedPointKernel
+{
+    int radius = 0;
+    std::vector<int32_t> values; // (radius+1) x (radius+1), indexed by [disty * (radius+1) + distx]
+};
+
+static FixedPointKernel MakeFixedPointKernel(int bits)
+{
+    // calculated in double and rounded, so that it comes out the same with any compiler
+    const double scale = double(1 << bits);
+
+    FixedPointKernel kernel;
+    while (int32_t(floor(exp(-double((kernel.radius + 1) * (kernel.radius + 1)) / double(c_2sigmaSquared)) * scale + 0.5)) > 0)
+        kernel.radius++;
+
+    kernel.values.resize((kernel.radius + 1) * (kernel.radius + 1));
+    for (int disty = 0; disty <= kernel.radius; ++disty)
+    {
+        for (int distx = 0; distx <= kernel.radius; ++distx)
+        {
+            double distanceSquared = double(distx * distx + disty * disty);
+            kernel.values[disty * (kernel.radius + 1) + distx] = int32_t(floor(exp(-distanceSquared / double(c_2sigmaSquared)) * scale + 0.5));
+        }
+    }
+    return kernel;
+}
+
+template <typename T>
+static const FixedPointKernel& GetFixedPointKernel()
+{
+    static const FixedPointKernel s_kernel = MakeFixedPointKernel(FixedPointBits<T>());
+    return s_kernel;
+}
+
+template <typename TBITS, typename TLUT>
+static void SaveLUTImage(const TBITS& binaryPattern, const TLUT& LUT, size_t width, size_t height, const char* fileName)
 {
     // get the LUT min and max
-    float LUTMin = LUT[0];
-    float LUTMax = LUT[0];
-    for (float f : LUT)
+    float LUTMin = float(LUT[0]);
+    float LUTMax = float(LUT[0]);
+    for (size_t index = 0; index < LUT.size(); ++index)
     {
-        LUTMin = std::min(LUTMin, f);
-        LUTMax = std::max(LUTMax, f);
+        LUTMin = std::min(LUTMin, float(LUT[index]));
+        LUTMax = std::max(LUTMax, float(LUT[index]));
     }
 
     size_t c_scale = 4;
 
-    std::vector<uint8_t> image(width*width * c_scale*c_scale * 3);
-    for (size_t index = 0; index < width*width*c_scale*c_scale; ++index)
+    std::vector<uint8_t> image(width*height * c_scale*c_scale * 3);
+    for (size_t index = 0; index < width*height*c_scale*c_scale; ++index)
     {
         size_t x = (index % (width * c_scale)) / c_scale;
         size_t y = index / (width * c_scale * c_scale);
 
-        float percent = (LUT[y*width + x] - LUTMin) / (LUTMax - LUTMin);
+        float percent = (float(LUT[y*width + x]) - LUTMin) / (LUTMax - LUTMin);
         uint8_t value = FromFloat<uint8_t>(percent);
 
         image[index * 3 + 0] = value;
@@ -43,15 +111,16 @@ static void SaveLUTImage(const std::vector<bool>& binaryPattern, std::vector<flo
             image[index * 3 + 2] = 0;
         }
     }
-    stbi_write_png(fileName, int(width*c_scale), int(width*c_scale), 3, image.data(), 0);
+    GetOutputQueue().WritePNG(fileName, width*c_scale, height*c_scale, 3, std::move(image));
 }
 
 #if 1
 
-template <bool CLUSTER>
-static bool FindWinnerLUT(const std::vector<float>& LUT, const std::vector<bool>& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rng)
+template <bool CLUSTER, typename TLUT, typename TBITS>
+static bool FindWinnerLUT(const TLUT& LUT, const TBITS& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rng)
 {
-    float bestValue = CLUSTER ? -FLT_MAX : FLT_MAX;
+    typedef typename TLUT::value_type T;
+    T bestValue = CLUSTER ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
     std::vector<size_t> bestIndices;
     for (size_t index = 0, count = LUT.size(); index < count; ++index)
     {
@@ -90,18 +159,21 @@ static bool FindWinnerLUT(const std::vector<float>& LUT, const std::vector<bool>
     return true;
 }
 
-static bool FindTightestClusterLUT(const std::vector<float>& LUT, const std::vector<bool>& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rng)
+template <typename TLUT, typename TBITS>
+static bool FindTightestClusterLUT(const TLUT& LUT, const TBITS& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rng)
 {
     return FindWinnerLUT<true>(LUT, binaryPattern, width, bestPixelX, bestPixelY, rng);
 }
 
-static bool FindLargestVoidLUT(const std::vector<float>& LUT, const std::vector<bool>& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rng)
+template <typename TLUT, typename TBITS>
+static bool FindLargestVoidLUT(const TLUT& LUT, const TBITS& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rng)
 {
     return FindWinnerLUT<false>(LUT, binaryPattern, width, bestPixelX, bestPixelY, rng);
 }
 
 #else
-static bool FindTightestClusterLUT(const std::vector<float>& LUT, const std::vector<bool>& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rn)
+template <typename TLUT, typename TBITS>
+static bool FindTightestClusterLUT(const TLUT& LUT, const TBITS& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rn)
 {
     float bestValue = -FLT_MAX;
     size_t bestIndex = ~size_t(0);
@@ -123,7 +195,8 @@ static bool FindTightestClusterLUT(const std::vector<float>& LUT, const std::vec
     return true;
 }
 
-static bool FindLargestVoidLUT(const std::vector<float>& LUT, const std::vector<bool>& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rn)
+template <typename TLUT, typename TBITS>
+static bool FindLargestVoidLUT(const TLUT& LUT, const TBITS& binaryPattern, size_t width, int &bestPixelX, int& bestPixelY, std::mt19937& rn)
 {
     float bestValue = FLT_MAX;
     size_t bestIndex = ~size_t(0);
@@ -146,14 +219,14 @@ static bool FindLargestVoidLUT(const std::vector<float>& LUT, const std::vector<
 }
 #endif
 
-static void WriteLUTValue(std::vector<float>& LUT, size_t width, bool value, int basex, int basey)
+static void WriteLUTValue(float* LUT, size_t width, size_t height, bool value, int basex, int basey)
 {
     #pragma omp parallel for
-    for (int y = 0; y < width; ++y)
+    for (int y = 0; y < height; ++y)
     {
         float disty = abs(float(y) - float(basey));
-        if (disty > float(width / 2))
-            disty = float(width) - disty;
+        if (disty > float(height / 2))
+            disty = float(height) - disty;
 
         for (size_t x = 0; x < width; ++x)
         {
@@ -168,29 +241,87 @@ static void WriteLUTValue(std::vector<float>& LUT, size_t width, bool value, int
     }
 }
 
-static void MakeLUT(const std::vector<bool>& binaryPattern, std::vector<float>& LUT, size_t width, bool writeOnes)
+// The pixels within radius of base on one axis, and their wrapped around distance from base.
+// If the axis is too small for the pixels to be distinct, every pixel is used once instead.
+static int GetAxisTaps(int base, size_t size, int radius, int* pixels, int* distances)
+{
+    if (radius * 2 + 1 >= int(size))
+    {
+        for (int pixel = 0; pixel < int(size); ++pixel)
+        {
+            int distance = std::abs(pixel - base);
+            pixels[pixel] = pixel;
+            distances[pixel] = std::min(distance, int(size) - distance);
+        }
+        return int(size);
+    }
+
+    for (int offset = -radius; offset <= radius; ++offset)
+    {
+        pixels[offset + radius] = (base + offset + int(size)) % int(size);
+        distances[offset + radius] = std::abs(offset);
+    }
+    return radius * 2 + 1;
+}
+
+// The fixed point version only writes the pixels that the kernel doesn't round to 0 for. Adding and removing a point are exact
+// integer adds, so removing a point exactly undoes adding it, and the LUT doesn't depend on the order points were written in.
+template <typename T>
+static void WriteLUTValue(T* LUT, size_t width, size_t height, bool value, int basex, int basey)
+{
+    const FixedPointKernel& kernel = GetFixedPointKernel<T>();
+
+    int pixelsX[c_maxFixedPointDiameter], distancesX[c_maxFixedPointDiameter];
+    int pixelsY[c_maxFixedPointDiameter], distancesY[c_maxFixedPointDiameter];
+    int countX = GetAxisTaps(basex, width, kernel.radius, pixelsX, distancesX);
+    int countY = GetAxisTaps(basey, height, kernel.radius, pixelsY, distancesY);
+
+    for (int iy = 0; iy < countY; ++iy)
+    {
+        if (distancesY[iy] > kernel.radius)
+            continue;
+
+        T* row = &LUT[pixelsY[iy] * width];
+        const int32_t* kernelRow = &kernel.values[distancesY[iy] * (kernel.radius + 1)];
+        for (int ix = 0; ix < countX; ++ix)
+        {
+            if (distancesX[ix] > kernel.radius)
+                continue;
+
+            if (value)
+                row[pixelsX[ix]] = T(row[pixelsX[ix]] + kernelRow[distancesX[ix]]);
+            else
+                row[pixelsX[ix]] = T(row[pixelsX[ix]] - kernelRow[distancesX[ix]]);
+        }
+    }
+}
+
+template <typename TBITS, typename TLUT>
+static void MakeLUT(const TBITS& binaryPattern, TLUT& LUT, size_t width, size_t height, bool writeOnes)
 {
+    typedef typename TLUT::value_type T;
     LUT.clear();
-    LUT.resize(width*width, 0.0f);
-    for (size_t index = 0; index < width*width; ++index)
+    LUT.resize(width*height, T(0));
+    for (size_t index = 0; index < width*height; ++index)
     {
         if (binaryPattern[index] == writeOnes)
         {
             int x = int(index % width);
             int y = int(index / width);
-            WriteLUTValue(LUT, width, writeOnes, x, y);
+            WriteLUTValue(LUT.data(), width, height, writeOnes, x, y);
         }
     }
 }
 
 #if SAVE_VOIDCLUSTER_INITIALBP()
 
-static void SaveBinaryPattern(const std::vector<bool>& binaryPattern, size_t width, const char* baseFileName, int iterationCount, int tightestClusterX, int tightestClusterY, int largestVoidX, int largestVoidY)
+template <typename TBITS>
+static void SaveBinaryPattern(const TBITS& binaryPattern, size_t width, size_t height, const char* baseFileName, int iterationCount, int tightestClusterX, int tightestClusterY, int largestVoidX, int largestVoidY)
 {
     size_t c_scale = 4;
 
-    std::vector<uint8_t> binaryPatternImage(width*width * c_scale*c_scale * 3);
-    for (size_t index = 0; index < width*width*c_scale*c_scale; ++index)
+    std::vector<uint8_t> binaryPatternImage(width*height * c_scale*c_scale * 3);
+    for (size_t index = 0; index < width*height*c_scale*c_scale; ++index)
     {
         size_t x = (index % (width * c_scale)) / c_scale;
         size_t y = index / (width * c_scale * c_scale);
@@ -229,31 +360,176 @@ static void SaveBinaryPattern(const std::vector<bool>& binaryPattern, size_t wid
 
     char fileName[256];
     sprintf(fileName, "%s%i.png", baseFileName, iterationCount);
-    stbi_write_png(fileName, int(width*c_scale), int(width*c_scale), 3, binaryPatternImage.data(), 0);
+    GetOutputQueue().WritePNG(fileName, width*c_scale, height*c_scale, 3, std::move(binaryPatternImage));
 }
 
 #endif
 
-static void MakeInitialBinaryPattern(std::vector<bool>& binaryPattern, size_t width, const char* baseFileName, std::mt19937& rng)
+template <typename TBITS>
+static size_t CountOnes(const TBITS& binaryPattern)
+{
+    size_t ones = 0;
+    for (size_t index = 0, count = binaryPattern.size(); index < count; ++index)
+    {
+        if (binaryPattern[index])
+            ones++;
+    }
+    return ones;
+}
+
+// A random looking 64 bit value for each pixel, from the splitmix64 finalizer. The hash of a binary pattern is these xored together
+// for each 1 in it, so moving a 1 updates the hash with two xors (Zobrist hashing). It doesn't use the rng, so the masks don't change.
+static uint64_t PixelHash(size_t pixel)
+{
+    uint64_t z = uint64_t(pixel) + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+template <typename TBITS>
+static uint64_t HashBinaryPattern(const TBITS& binaryPattern)
+{
+    uint64_t hash = 0;
+    for (size_t index = 0, count = binaryPattern.size(); index < count; ++index)
+    {
+        if (binaryPattern[index])
+            hash ^= PixelHash(index);
+    }
+    return hash;
+}
+
+// The state of void and cluster between two iterations of a phase. Phase 0 is making the initial binary pattern.
+// initialOnes is only needed in phase 1, to remake the initial pattern for phase 2, and recentPatterns is only needed in phase 0.
+template <typename TBITS, typename TLUT, typename TRANKS>
+static void SaveVoidClusterCheckpoint(Checkpoint& checkpoint, int phase, int iterationCount, size_t initialOnes, const TBITS& binaryPattern, const TLUT& LUT, const TRANKS& ranks, const std::mt19937& rng, const std::vector<uint64_t>& recentPatterns = std::vector<uint64_t>())
+{
+    checkpoint.Write(int32_t(phase));
+    checkpoint.Write(int32_t(iterationCount));
+    checkpoint.Write(uint64_t(initialOnes));
+    checkpoint.WriteRNG(rng);
+    checkpoint.WriteBits(binaryPattern);
+    checkpoint.WriteVector(LUT);
+    if (phase > 0)
+        checkpoint.WriteVector(ranks);
+    checkpoint.WriteVector(recentPatterns);
+    checkpoint.Save();
+}
+
+// In phase 0 the pattern is the initial binary pattern, and in the other phases it's the working binary pattern
+// nothing is ranked in phase 0, so the ranks aren't saved then, and start out unranked when loaded.
+template <typename TBITS, typename TLUT, typename TRANKS>
+static bool LoadVoidClusterCheckpoint(Checkpoint& checkpoint, size_t width, size_t height, int& phase, int& iterationCount, size_t& initialOnes, TBITS& initialBinaryPattern, TBITS& binaryPattern, TLUT& LUT, TRANKS& ranks, std::mt19937& rng, std::vector<uint64_t>& recentPatterns)
+{
+    if (!checkpoint.Load())
+        return false;
+
+    int32_t storedPhase = 0;
+    int32_t storedIterationCount = 0;
+    uint64_t storedInitialOnes = 0;
+    checkpoint.Read(storedPhase);
+    checkpoint.Read(storedIterationCount);
+    checkpoint.Read(storedInitialOnes);
+    checkpoint.ReadRNG(rng);
+    checkpoint.ReadBits(storedPhase == 0 ? initialBinaryPattern : binaryPattern);
+    checkpoint.ReadVector(LUT);
+    if (storedPhase > 0)
+    {
+        checkpoint.ReadVector(ranks);
+    }
+    else
+    {
+        ranks.clear();
+        ranks.resize(width*height, ~uint32_t(0));
+    }
+    checkpoint.ReadVector(recentPatterns);
+
+    if (!checkpoint.FinishLoad() || storedPhase < 0 || storedPhase > 3 || LUT.size() != width * height || ranks.size() != width * height)
+    {
+        // start over
+        printf("Checkpoint is damaged, ignoring it\n");
+        rng = std::mt19937(GetRNGSeed());
+        initialBinaryPattern.clear();
+        binaryPattern.clear();
+        LUT.clear();
+        ranks.clear();
+        recentPatterns.clear();
+        return false;
+    }
+
+    phase = storedPhase;
+    iterationCount = storedIterationCount;
+    initialOnes = size_t(storedInitialOnes);
+    return true;
+}
+
+// LUT is only used as scratch memory. The LUT for phase 1 is made from the finished pattern.
+// If resuming, binaryPattern, LUT and recentPatterns are as they were after iteration iterationCount.
+// If startFromBinaryPattern is true, it refines the points already in binaryPattern instead of starting from white noise.
+// checkpoint and ranks are only used for saving checkpoints, and checkpoint can be null to not save any.
+//
+// Each iteration moves the 1 in the tightest cluster to the largest void, and the pattern is done when those are the same pixel.
+// Ties, especially with the float LUT, can make it move points around in a loop forever instead. That is found by remembering the
+// hashes of the last VOIDCLUSTER_INITIALBP_CYCLE_WINDOW() patterns. Coming back to one of them means the pattern is going around in a
+// cycle, and no pattern in the cycle is any better than the others, so it stops there.
+// recentPatterns is a ring buffer of those hashes, with the pattern after iteration i at index i % VOIDCLUSTER_INITIALBP_CYCLE_WINDOW().
+template <typename TBITS, typename TLUT, typename TRANKS>
+static InitialPatternReport MakeInitialBinaryPattern(TBITS& binaryPattern, TLUT& LUT, const TRANKS& ranks, size_t width, size_t height, const char* baseFileName, std::mt19937& rng, Checkpoint* checkpoint, bool resume, int iterationCount, std::vector<uint64_t>& recentPatterns, bool startFromBinaryPattern = false, float maxIterationsPerPoint = float(VOIDCLUSTER_INITIALBP_MAX_ITERATIONS_PER_POINT()))
 {
     ScopedTimer timer("Initial Pattern", false);
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    if (!resume && startFromBinaryPattern)
+    {
+        MakeLUT(binaryPattern, LUT, width, height, true);
+        iterationCount = 0;
+        recentPatterns.clear();
+    }
+    else if (!resume)
+    {
+        std::uniform_int_distribution<size_t> dist(0, width*height - 1);
 
-    std::uniform_int_distribution<size_t> dist(0, width*width);
+        typedef typename TLUT::value_type T;
+        LUT.clear();
+        LUT.resize(width*height, T(0));
 
-    std::vector<float> LUT;
-    LUT.resize(width*width, 0.0f);
+        binaryPattern.resize(width*height, false);
+        size_t ones = size_t(float(width*height) * 0.1f); // start 10% of the pixels as white
+        for (size_t index = 0; index < ones; ++index)
+        {
+            size_t pixel = dist(rng);
+            binaryPattern[pixel] = true;
+            WriteLUTValue(LUT.data(), width, height, true, int(pixel % width), int(pixel / width));
+        }
+        iterationCount = 0;
+        recentPatterns.clear();
+    }
+
+    // every iteration moves a 1, so there are always the same number of them
+    const size_t ones = CountOnes(binaryPattern);
+    const size_t maxIterations = size_t(double(ones) * double(maxIterationsPerPoint));
 
-    binaryPattern.resize(width*width, false);
-    size_t ones = size_t(float(width*width) * 0.1f); // start 10% of the pixels as white
-    for (size_t index = 0; index < ones; ++index)
+    // remember the hashes of the recent patterns, and which iteration made each one
+    const int cycleWindow = VOIDCLUSTER_INITIALBP_CYCLE_WINDOW();
+    std::unordered_map<uint64_t, int> recentPatternIterations;
+    uint64_t patternHash = HashBinaryPattern(binaryPattern);
+    if (cycleWindow > 0)
     {
-        size_t pixel = dist(rng);
-        binaryPattern[pixel] = true;
-        WriteLUTValue(LUT, width, true, int(pixel % width), int(pixel / width));
+        recentPatternIterations.reserve(size_t(cycleWindow));
+        if (recentPatterns.size() == size_t(cycleWindow))
+        {
+            for (int iteration = std::max(iterationCount - cycleWindow + 1, 0); iteration < iterationCount; ++iteration)
+                recentPatternIterations[recentPatterns[iteration % cycleWindow]] = iteration;
+        }
+        else
+            recentPatterns.assign(size_t(cycleWindow), 0);
+        recentPatterns[iterationCount % cycleWindow] = patternHash;
+        recentPatternIterations[patternHash] = iterationCount;
     }
 
-    int iterationCount = 0;
-    while (1)
+    InitialPatternReport report;
+    report.outcome = startFromBinaryPattern ? InitialPatternOutcome::Refined : InitialPatternOutcome::IterationLimit;
+    while (maxIterations == 0 || size_t(iterationCount) < maxIterations)
     {
         printf("\r%i iterations", iterationCount);
         iterationCount++;
@@ -265,7 +541,8 @@ static void MakeInitialBinaryPattern(std::vector<bool>& binaryPattern, size_t wi
 
         // remove the 1 from the tightest cluster
         binaryPattern[tightestClusterY*width + tightestClusterX] = false;
-        WriteLUTValue(LUT, width, false, tightestClusterX, tightestClusterY);
+        WriteLUTValue(LUT.data(), width, height, false, tightestClusterX, tightestClusterY);
+        patternHash ^= PixelHash(tightestClusterY*width + tightestClusterX);
 
         // find the largest void
         int largestVoidX = -1;
@@ -274,33 +551,70 @@ static void MakeInitialBinaryPattern(std::vector<bool>& binaryPattern, size_t wi
 
         // put the 1 in the largest void
         binaryPattern[largestVoidY*width + largestVoidX] = true;
-        WriteLUTValue(LUT, width, true, largestVoidX, largestVoidY);
+        WriteLUTValue(LUT.data(), width, height, true, largestVoidX, largestVoidY);
+        patternHash ^= PixelHash(largestVoidY*width + largestVoidX);
 
         #if SAVE_VOIDCLUSTER_INITIALBP()
         // save the binary pattern out for debug purposes
-        SaveBinaryPattern(binaryPattern, width, baseFileName, iterationCount, tightestClusterX, tightestClusterY, largestVoidX, largestVoidY);
+        SaveBinaryPattern(binaryPattern, width, height, baseFileName, iterationCount, tightestClusterX, tightestClusterY, largestVoidX, largestVoidY);
         #endif
 
         // exit condition. the pattern is stable
         if (tightestClusterX == largestVoidX && tightestClusterY == largestVoidY)
+        {
+            report.outcome = InitialPatternOutcome::Stable;
             break;
+        }
+
+        // exit condition. the pattern is going around in a cycle
+        if (cycleWindow > 0)
+        {
+            std::unordered_map<uint64_t, int>::iterator it = recentPatternIterations.find(patternHash);
+            if (it != recentPatternIterations.end())
+            {
+                report.outcome = InitialPatternOutcome::Cycle;
+                report.cycleLength = iterationCount - it->second;
+                break;
+            }
+
+            // the pattern from cycleWindow iterations ago drops out of the window to make room for this one
+            uint64_t& slot = recentPatterns[iterationCount % cycleWindow];
+            if (iterationCount >= cycleWindow)
+                recentPatternIterations.erase(slot);
+            slot = patternHash;
+            recentPatternIterations[patternHash] = iterationCount;
+        }
+
+        if (checkpoint && checkpoint->Due())
+            SaveVoidClusterCheckpoint(*checkpoint, 0, iterationCount, 0, binaryPattern, LUT, ranks, rng, recentPatterns);
     }
     printf("\n");
+
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    report.iterations = iterationCount;
+    report.seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+    switch (report.outcome)
+    {
+        case InitialPatternOutcome::Stable: printf("Stable after %i iterations, %0.2f per point\n", report.iterations, double(report.iterations) / double(ones)); break;
+        case InitialPatternOutcome::Cycle: printf("Stopped after %i iterations, in a cycle of %i moves\n", report.iterations, report.cycleLength); break;
+        case InitialPatternOutcome::IterationLimit: printf("Stopped at the limit of %i iterations without being stable\n", report.iterations); break;
+        case InitialPatternOutcome::Refined: printf("Refined for %i iterations, %0.2f per point\n", report.iterations, double(report.iterations) / double(ones)); break;
+    }
+    return report;
 }
 
 // Phase 1: Start with initial binary pattern and remove the tightest cluster until there are none left, entering ranks for those pixels
-static void Phase1(std::vector<bool>& binaryPattern, std::vector<float>& LUT, std::vector<size_t>& ranks, size_t width, std::mt19937& rng, const char* baseFileName)
+// initialOnes is how many ones the initial binary pattern had. When resuming, binaryPattern will have fewer.
+// checkpoint can be null to not save any.
+template <typename TBITS, typename TLUT, typename TRANKS>
+static void Phase1(TBITS& binaryPattern, TLUT& LUT, TRANKS& ranks, size_t initialOnes, size_t width, size_t height, std::mt19937& rng, const char* baseFileName, Checkpoint* checkpoint)
 {
     ScopedTimer timer("Phase 1", false);
 
     // count how many ones there are
-    size_t ones = 0;
-    for (bool b : binaryPattern)
-    {
-        if (b)
-            ones++;
-    }
-    size_t startingOnes = ones;
+    size_t ones = CountOnes(binaryPattern);
+    size_t startingOnes = initialOnes;
 
     // remove the tightest cluster repeatedly
     while (ones > 0)
@@ -310,14 +624,17 @@ static void Phase1(std::vector<bool>& binaryPattern, std::vector<float>& LUT, st
         int bestX, bestY;
         FindTightestClusterLUT(LUT, binaryPattern, width, bestX, bestY, rng);
         binaryPattern[bestY * width + bestX] = false;
-        WriteLUTValue(LUT, width, false, bestX, bestY);
+        WriteLUTValue(LUT.data(), width, height, false, bestX, bestY);
         ones--;
-        ranks[bestY*width + bestX] = ones;
+        ranks[bestY*width + bestX] = uint32_t(ones);
 
         #if SAVE_VOIDCLUSTER_PHASE1()
         // save the binary pattern out for debug purposes
-        SaveBinaryPattern(binaryPattern, width, baseFileName, int(startingOnes - ones), bestX, bestY, -1, -1);
+        SaveBinaryPattern(binaryPattern, width, height, baseFileName, int(startingOnes - ones), bestX, bestY, -1, -1);
         #endif
+
+        if (checkpoint && checkpoint->Due())
+            SaveVoidClusterCheckpoint(*checkpoint, 1, 0, initialOnes, binaryPattern, LUT, ranks, rng);
     }
     printf("\n");
 }
@@ -330,7 +647,7 @@ struct Point
 typedef std::vector<Point> TPoints;
 typedef std::vector<TPoints> TPointGrid;
 
-static bool DistanceSqToClosestPoint(const TPoints& points, const Point& point, float& minDistSq, size_t width)
+static bool DistanceSqToClosestPoint(const TPoints& points, const Point& point, float& minDistSq, size_t width, size_t height)
 {
     if (points.size() == 0)
         return false;
@@ -344,8 +661,8 @@ static bool DistanceSqToClosestPoint(const TPoints& points, const Point& point,
         if (distx > float(width) / 2.0f)
             distx = float(width) - distx;
 
-        if (disty > float(width) / 2.0f)
-            disty = float(width) - disty;
+        if (disty > float(height) / 2.0f)
+            disty = float(height) - disty;
 
         float distSq = distx * distx + disty * disty;
         if (distSq < minDistSq)
@@ -354,12 +671,20 @@ static bool DistanceSqToClosestPoint(const TPoints& points, const Point& point,
     return true;
 }
 
-static float DistanceSqToClosestPoint(const TPointGrid& grid, size_t cellCount, size_t cellSize, const Point& point, size_t width)
+// The grid has cellCountX by cellCountY cells, which wrap around like the image does
+static float DistanceSqToClosestPoint(const TPointGrid& grid, size_t cellCountX, size_t cellCountY, const Point& point, size_t width, size_t height)
 {
-    const int basex = int(point.x / cellSize);
-    const int basey = int(point.y / cellSize);
-
-    const int maxRadius = int(cellCount / 2);
+    const int countX = int(cellCountX);
+    const int countY = int(cellCountY);
+    const int basex = int(point.x * cellCountX / width);
+    const int basey = int(point.y * cellCountY / height);
+
+    // the offsets on each axis reach every cell on that axis exactly once, so an axis with few cells isn't searched twice
+    const int minOffsetX = -(countX - 1) / 2;
+    const int maxOffsetX = countX / 2;
+    const int minOffsetY = -(countY - 1) / 2;
+    const int maxOffsetY = countY / 2;
+    const int maxRadius = std::max(maxOffsetX, maxOffsetY);
 
     float minDistSq = FLT_MAX;
     bool foundAPoint = false;
@@ -367,35 +692,42 @@ static float DistanceSqToClosestPoint(const TPointGrid& grid, size_t cellCount,
 
     for (int radius = 0; radius <= maxRadius; ++radius)
     {
+        const int ringMinX = std::max(-radius, minOffsetX);
+        const int ringMaxX = std::min(radius, maxOffsetX);
+
         // top and bottom rows
+        for (int offsetX = ringMinX; offsetX <= ringMaxX; ++offsetX)
         {
-            for (int offsetX = -radius; offsetX <= radius; ++offsetX)
-            {
-                int x = int(basex + offsetX + cellCount) % int(cellCount);
+            int x = ((basex + offsetX) % countX + countX) % countX;
 
-                int offsetY = -radius;
-                int y = int(basey + offsetY + cellCount) % int(cellCount);
-                foundAPoint |= DistanceSqToClosestPoint(grid[y*cellCount + x], point, minDistSq, width);
+            if (-radius >= minOffsetY)
+            {
+                int y = ((basey - radius) % countY + countY) % countY;
+                foundAPoint |= DistanceSqToClosestPoint(grid[y*cellCountX + x], point, minDistSq, width, height);
+            }
 
-                offsetY = radius;
-                y = int(basey + offsetY + cellCount) % int(cellCount);
-                foundAPoint |= DistanceSqToClosestPoint(grid[y*cellCount + x], point, minDistSq, width);
+            if (radius > 0 && radius <= maxOffsetY)
+            {
+                int y = ((basey + radius) % countY + countY) % countY;
+                foundAPoint |= DistanceSqToClosestPoint(grid[y*cellCountX + x], point, minDistSq, width, height);
             }
         }
 
         // left and right
+        for (int offsetY = std::max(-radius + 1, minOffsetY); offsetY <= std::min(radius - 1, maxOffsetY); ++offsetY)
         {
-            for (int offsetY = -radius + 1; offsetY <= radius - 1; ++offsetY)
-            {
-                int y = int(basey + offsetY + cellCount) % int(cellCount);
+            int y = ((basey + offsetY) % countY + countY) % countY;
 
-                int offsetX = -radius;
-                int x = int(basex + offsetX + cellCount) % int(cellCount);
-                foundAPoint |= DistanceSqToClosestPoint(grid[y*cellCount + x], point, minDistSq, width);
+            if (-radius >= minOffsetX)
+            {
+                int x = ((basex - radius) % countX + countX) % countX;
+                foundAPoint |= DistanceSqToClosestPoint(grid[y*cellCountX + x], point, minDistSq, width, height);
+            }
 
-                offsetX = +radius;
-                x = int(basex + offsetX + cellCount) % int(cellCount);
-                foundAPoint |= DistanceSqToClosestPoint(grid[y*cellCount + x], point, minDistSq, width);
+            if (radius <= maxOffsetX)
+            {
+                int x = ((basex + radius) % countX + countX) % countX;
+                foundAPoint |= DistanceSqToClosestPoint(grid[y*cellCountX + x], point, minDistSq, width, height);
             }
         }
 
@@ -412,12 +744,12 @@ static float DistanceSqToClosestPoint(const TPointGrid& grid, size_t cellCount,
     return minDistSq;
 }
 
-static void AddPointToPointGrid(TPointGrid& grid, size_t cellCount, size_t cellSize, const Point& point)
+static void AddPointToPointGrid(TPointGrid& grid, size_t cellCountX, size_t cellCountY, const Point& point, size_t width, size_t height)
 {
     Point cell;
-    cell.x = point.x / cellSize;
-    cell.y = point.y / cellSize;
-    grid[cell.y * cellCount + cell.x].push_back(point);
+    cell.x = point.x * cellCountX / width;
+    cell.y = point.y * cellCountY / height;
+    grid[cell.y * cellCountX + cell.x].push_back(point);
 }
 
 // This replaces "Initial Binary Pattern" and "Phase 1" in the void and cluster algorithm.
@@ -425,21 +757,26 @@ static void AddPointToPointGrid(TPointGrid& grid, size_t cellCount, size_t cellS
 // Phase 1 makes them be progressive, so any points from 0 to N are blue noise.
 // Mitchell's best candidate algorithm makes progressive blue noise so can be used instead of those 2 steps.
 // https://blog.demofox.org/2017/10/20/generating-blue-noise-sample-points-with-mitchells-best-candidate-algorithm/
-static void MitchellsBestCandidate(std::vector<bool>& binaryPattern, std::vector<size_t>& ranks, size_t width)
+template <typename TBITS, typename TRANKS>
+static void MitchellsBestCandidate(TBITS& binaryPattern, TRANKS& ranks, size_t width, size_t height)
 {
     ScopedTimer timer("Mitchells Best Candidate", false);
 
     std::mt19937 rng(GetRNGSeed());
-    std::uniform_int_distribution<size_t> dist(0, width*width - 1);
+    std::uniform_int_distribution<size_t> dist(0, width*height - 1);
 
-    binaryPattern.resize(width*width, false);
-    ranks.resize(width*width, ~size_t(0));
+    binaryPattern.resize(width*height, false);
+    ranks.resize(width*height, ~uint32_t(0));
 
+    // up to 32 grid cells on the shorter axis, but not smaller than a pixel. The cells are square, so the longer axis has more of them.
     static const size_t gridCellCount = 32;
-    TPointGrid grid(gridCellCount*gridCellCount);
-    const size_t gridCellSize = width / gridCellCount;
+    const size_t shorterSide = std::min(width, height);
+    const size_t shorterCellCount = std::min(gridCellCount, shorterSide);
+    const size_t gridCellCountX = std::max<size_t>(1, width * shorterCellCount / shorterSide);
+    const size_t gridCellCountY = std::max<size_t>(1, height * shorterCellCount / shorterSide);
+    TPointGrid grid(gridCellCountX*gridCellCountY);
 
-    size_t ones = size_t(float(width * width)*0.1f);
+    size_t ones = size_t(float(width * height)*0.1f);
     for (size_t i = 0; i < ones; ++i)
     {
         printf("\r%i%%", int(100.0f * float(i) / float(ones - 1)));
@@ -457,7 +794,7 @@ static void MitchellsBestCandidate(std::vector<bool>& binaryPattern, std::vector
             c.x = index % width;
             c.y = index / width;
 
-            float minDistSq = DistanceSqToClosestPoint(grid, gridCellCount, gridCellSize, c, width);
+            float minDistSq = DistanceSqToClosestPoint(grid, gridCellCountX, gridCellCountY, c, width, height);
 
             if (minDistSq > bestDistanceSq)
             {
@@ -468,29 +805,276 @@ static void MitchellsBestCandidate(std::vector<bool>& binaryPattern, std::vector
 
         // take the best candidate
         binaryPattern[best.y * width + best.x] = true;
-        ranks[best.y * width + best.x] = i;
-        AddPointToPointGrid(grid, gridCellCount, gridCellSize, best);
+        ranks[best.y * width + best.x] = uint32_t(i);
+        AddPointToPointGrid(grid, gridCellCountX, gridCellCountY, best, width, height);
     }
     printf("\n");
 }
 
-// Phase 2: Start with initial binary pattern and add points to the largest void until half the pixels are white, entering ranks for those pixels
-static void Phase2(std::vector<bool>& binaryPattern, std::vector<float>& LUT, std::vector<size_t>& ranks, size_t width, std::mt19937& rng)
+// The initial binary patterns below aim for the same 10% density as the classic initial binary pattern.
+static const float c_initialPatternDensity = 0.1f;
+
+// A Poisson disk sampling of the pixels, using Bridson's algorithm, wrapping around the edges. It replaces "Initial Binary Pattern" only,
+// since the points aren't progressive. Phase 1 then ranks them.
+// A maximal Poisson disk sampling has about 0.7 points per radius^2 of area, so the radius is chosen to give about 10% density.
+// https://www.cs.ubc.ca/~rbridson/docs/bridson-siggraph07-poissondisk.pdf
+template <typename TBITS>
+static void PoissonDiskSampling(TBITS& binaryPattern, size_t width, size_t height, std::mt19937& rng)
 {
-    ScopedTimer timer("Phase 2", false);
+    ScopedTimer timer("Poisson Disk", false);
+
+    static const float c_pointsPerRadiusSquared = 0.7f;
+    static const int c_candidates = 30;
+    const float radius = std::sqrt(c_pointsPerRadiusSquared / c_initialPatternDensity);
+    const float radiusSquared = radius * radius;
+
+    binaryPattern.resize(width*height, false);
+
+    // grid cells about the size of the radius, so only nearby cells have points close enough to matter
+    const size_t gridCellCountX = std::max<size_t>(1, size_t(float(width) / radius));
+    const size_t gridCellCountY = std::max<size_t>(1, size_t(float(height) / radius));
+    TPointGrid grid(gridCellCountX*gridCellCountY);
+
+    std::uniform_int_distribution<size_t> distPixel(0, width*height - 1);
+    std::uniform_real_distribution<float> distAngle(0.0f, 6.28318530718f);
+    std::uniform_real_distribution<float> distRadius(radius, radius * 2.0f);
+
+    // start with a random point, and keep a list of the points that might still have room around them
+    Point first;
+    size_t firstIndex = distPixel(rng);
+    first.x = firstIndex % width;
+    first.y = firstIndex / width;
+    binaryPattern[firstIndex] = true;
+    AddPointToPointGrid(grid, gridCellCountX, gridCellCountY, first, width, height);
+    std::vector<Point> active(1, first);
+
+    while (!active.empty())
+    {
+        // try candidates in the ring between 1 and 2 radii around a random active point
+        std::uniform_int_distribution<size_t> distActive(0, active.size() - 1);
+        size_t activeIndex = distActive(rng);
+        Point base = active[activeIndex];
 
-    // count how many ones there are
+        bool found = false;
+        for (int candidate = 0; candidate < c_candidates; ++candidate)
+        {
+            float angle = distAngle(rng);
+            float distance = distRadius(rng);
+            int x = int(std::floor(float(base.x) + std::cos(angle) * distance + 0.5f));
+            int y = int(std::floor(float(base.y) + std::sin(angle) * distance + 0.5f));
+
+            Point c;
+            c.x = size_t((x % int(width) + int(width)) % int(width));
+            c.y = size_t((y % int(height) + int(height)) % int(height));
+            if (binaryPattern[c.y * width + c.x] || DistanceSqToClosestPoint(grid, gridCellCountX, gridCellCountY, c, width, height) < radiusSquared)
+                continue;
+
+            binaryPattern[c.y * width + c.x] = true;
+            AddPointToPointGrid(grid, gridCellCountX, gridCellCountY, c, width, height);
+            active.push_back(c);
+            found = true;
+            break;
+        }
+
+        // the point has no room left around it
+        if (!found)
+        {
+            active[activeIndex] = active.back();
+            active.pop_back();
+        }
+    }
+    printf("%zu points, %0.2f%%\n", CountOnes(binaryPattern), 100.0f * float(CountOnes(binaryPattern)) / float(width*height));
+}
+
+// A capacity constrained Voronoi diagram: points where every point has the same number of pixels closest to it, which is blue noise.
+// It replaces "Initial Binary Pattern" only, like the Poisson disk sampling.
+// Balzer et al swap pixels between pairs of cells, which is serial. This does it the way "Blue Noise through Optimal Transport"
+// (de Goes et al) does instead: each point has a weight, and pixels go to the point with the smallest distance squared minus weight.
+// Every iteration assigns every pixel in parallel, moves each point to the middle of its pixels like Lloyd relaxation does, and grows
+// the weights of points with too few pixels and shrinks the weights of points with too many, so the cells end up the same size.
+// https://graphics.uni-konstanz.de/publikationen/Balzer2009CapacityconstrainedPointDistributions/
+// http://www.geometry.caltech.edu/pubs/dGBOD12.pdf
+template <typename TBITS>
+static void CapacityConstrainedVoronoi(TBITS& binaryPattern, size_t width, size_t height, std::mt19937& rng)
+{
+    ScopedTimer timer("Capacity Constrained Voronoi", false);
+
+    static const float c_weightStep = 0.25f;
+
+    const size_t pointCount = std::max<size_t>(1, size_t(float(width*height) * c_initialPatternDensity));
+    const float capacity = float(width*height) / float(pointCount);
+
+    // start with points at random pixels
+    std::vector<float> pointsX(pointCount), pointsY(pointCount), weights(pointCount, 0.0f);
+    {
+        std::uniform_int_distribution<size_t> dist(0, width*height - 1);
+        std::vector<bool> taken(width*height, false);
+        for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+        {
+            size_t pixel = dist(rng);
+            while (taken[pixel])
+                pixel = dist(rng);
+            taken[pixel] = true;
+            pointsX[pointIndex] = float(pixel % width);
+            pointsY[pointIndex] = float(pixel / width);
+        }
+    }
+
+    // grid cells at least two points apart, so the 3x3 cells around a pixel have every point that could be closest to it
+    const float pointSpacing = std::sqrt(capacity);
+    const int gridCellCountX = std::max(1, int(float(width) / (pointSpacing * 2.0f)));
+    const int gridCellCountY = std::max(1, int(float(height) / (pointSpacing * 2.0f)));
+    std::vector<std::vector<int>> grid(gridCellCountX * gridCellCountY);
+
+    std::vector<int> owners(width*height);
+    std::vector<double> sumX(pointCount), sumY(pointCount);
+    std::vector<int> areas(pointCount);
+
+    for (int iteration = 0; iteration < VOIDCLUSTER_CCVD_ITERATIONS(); ++iteration)
+    {
+        printf("\r%i%%", int(100.0f * float(iteration) / float(VOIDCLUSTER_CCVD_ITERATIONS())));
+
+        for (std::vector<int>& cell : grid)
+            cell.clear();
+        for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+        {
+            int cellX = std::min(int(pointsX[pointIndex] * float(gridCellCountX) / float(width)), gridCellCountX - 1);
+            int cellY = std::min(int(pointsY[pointIndex] * float(gridCellCountY) / float(height)), gridCellCountY - 1);
+            grid[cellY * gridCellCountX + cellX].push_back(int(pointIndex));
+        }
+
+        // give each pixel to the point with the smallest weighted distance
+        #pragma omp parallel for
+        for (int y = 0; y < int(height); ++y)
+        {
+            int cellY = int(size_t(y) * size_t(gridCellCountY) / height);
+            for (size_t x = 0; x < width; ++x)
+            {
+                int cellX = int(x * size_t(gridCellCountX) / width);
+
+                float bestDistance = FLT_MAX;
+                int bestPoint = -1;
+                for (int offsetY = -1; offsetY <= 1; ++offsetY)
+                {
+                    // small grids have fewer than 3 cells, which mustn't be visited twice
+                    if (offsetY != 0 && gridCellCountY < 3 && (offsetY > 0 || gridCellCountY == 1))
+                        continue;
+                    int neighborY = (cellY + offsetY + gridCellCountY) % gridCellCountY;
+                    for (int offsetX = -1; offsetX <= 1; ++offsetX)
+                    {
+                        if (offsetX != 0 && gridCellCountX < 3 && (offsetX > 0 || gridCellCountX == 1))
+                            continue;
+                        int neighborX = (cellX + offsetX + gridCellCountX) % gridCellCountX;
+                        for (int pointIndex : grid[neighborY * gridCellCountX + neighborX])
+                        {
+                            float distx = std::abs(pointsX[pointIndex] - float(x));
+                            float disty = std::abs(pointsY[pointIndex] - float(y));
+                            if (distx > float(width) / 2.0f)
+                                distx = float(width) - distx;
+                            if (disty > float(height) / 2.0f)
+                                disty = float(height) - disty;
+
+                            float distance = distx * distx + disty * disty - weights[pointIndex];
+                            if (distance < bestDistance)
+                            {
+                                bestDistance = distance;
+                                bestPoint = pointIndex;
+                            }
+                        }
+                    }
+                }
+                owners[size_t(y) * width + x] = bestPoint;
+            }
+        }
+
+        // sum up the area of each cell, and where its pixels are relative to its point, wrapping around
+        std::fill(sumX.begin(), sumX.end(), 0.0);
+        std::fill(sumY.begin(), sumY.end(), 0.0);
+        std::fill(areas.begin(), areas.end(), 0);
+        for (size_t index = 0; index < width*height; ++index)
+        {
+            int owner = owners[index];
+            if (owner < 0)
+                continue;
+
+            float offsetX = float(index % width) - pointsX[owner];
+            float offsetY = float(index / width) - pointsY[owner];
+            if (offsetX > float(width) / 2.0f)
+                offsetX -= float(width);
+            else if (offsetX < -float(width) / 2.0f)
+                offsetX += float(width);
+            if (offsetY > float(height) / 2.0f)
+                offsetY -= float(height);
+            else if (offsetY < -float(height) / 2.0f)
+                offsetY += float(height);
+
+            sumX[owner] += offsetX;
+            sumY[owner] += offsetY;
+            areas[owner]++;
+        }
+
+        // move the points to the middle of their cells, and adjust the weights towards every cell having the same area
+        for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+        {
+            if (areas[pointIndex] > 0)
+            {
+                pointsX[pointIndex] = std::fmod(pointsX[pointIndex] + float(sumX[pointIndex] / double(areas[pointIndex])) + float(width), float(width));
+                pointsY[pointIndex] = std::fmod(pointsY[pointIndex] + float(sumY[pointIndex] / double(areas[pointIndex])) + float(height), float(height));
+            }
+            weights[pointIndex] += c_weightStep * (capacity - float(areas[pointIndex]));
+        }
+    }
+    printf("\r100%%\n");
+
+    // the points go on their closest pixels. Points that are that close together are rare, and just become one point.
+    binaryPattern.resize(width*height, false);
+    for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+    {
+        size_t x = size_t(std::floor(pointsX[pointIndex] + 0.5f)) % width;
+        size_t y = size_t(std::floor(pointsY[pointIndex] + 0.5f)) % height;
+        binaryPattern[y * width + x] = true;
+    }
+    printf("%zu points, %0.2f%%\n", CountOnes(binaryPattern), 100.0f * float(CountOnes(binaryPattern)) / float(width*height));
+}
+
+// Runs a fast blue noise generator and thresholds it, so the pixels below VOIDCLUSTER_THRESHOLD_DENSITY() become the initial binary pattern.
+// Thresholding a blue noise mask gives blue noise points, so this skips most of the work the initial binary pattern does.
+template <typename TBITS>
+static void ThresholdedBlueNoise(TBITS& binaryPattern, size_t width, size_t height, VoidClusterInitialPattern initialPattern)
+{
+    ScopedTimer timer("Thresholded blue noise", false);
+
+    std::vector<uint8_t> noise;
+    if (initialPattern == VoidClusterInitialPattern::ThresholdedPaniq)
+        GenerateBN_Paniq(noise, width, height, VOIDCLUSTER_THRESHOLD_PANIQ_ITERATIONS(), true);
+    else
+        GenerateBN_HPF(noise, width, height);
+
+    // the masks have flat histograms, so this gives very close to the asked for density
+    const int threshold = int(VOIDCLUSTER_THRESHOLD_DENSITY() * 256.0f + 0.5f);
+    binaryPattern.resize(width*height, false);
     size_t ones = 0;
-    for (bool b : binaryPattern)
+    for (size_t index = 0; index < width*height; ++index)
     {
-        if (b)
-            ones++;
+        binaryPattern[index] = int(noise[index]) < threshold;
+        ones += int(noise[index]) < threshold ? 1 : 0;
     }
+    printf("%zu points below threshold %i\n", ones, threshold);
+}
+
+// Phase 2: Start with initial binary pattern and add points to the largest void until half the pixels are white, entering ranks for those pixels
+template <typename TBITS, typename TLUT, typename TRANKS>
+static void Phase2(TBITS& binaryPattern, TLUT& LUT, TRANKS& ranks, size_t width, size_t height, std::mt19937& rng, Checkpoint& checkpoint)
+{
+    ScopedTimer timer("Phase 2", false);
+
+    // count how many ones there are
+    size_t ones = CountOnes(binaryPattern);
     size_t startingOnes = ones;
-    size_t onesToDo = (width*width / 2) - startingOnes;
+    size_t onesToDo = (width*height / 2) - startingOnes;
 
     // add to the largest void repeatedly
-    while (ones <= (width*width/2))
+    while (ones <= (width*height/2))
     {
         size_t onesDone = ones - startingOnes;
         printf("\r%i%%", int(100.0f * float(onesDone) / float(onesToDo)));
@@ -498,27 +1082,26 @@ static void Phase2(std::vector<bool>& binaryPattern, std::vector<float>& LUT, st
         int bestX, bestY;
         FindLargestVoidLUT(LUT, binaryPattern, width, bestX, bestY, rng);
         binaryPattern[bestY * width + bestX] = true;
-        WriteLUTValue(LUT, width, true, bestX, bestY);
-        ranks[bestY*width + bestX] = ones;
+        WriteLUTValue(LUT.data(), width, height, true, bestX, bestY);
+        ranks[bestY*width + bestX] = uint32_t(ones);
         ones++;
+
+        if (checkpoint.Due())
+            SaveVoidClusterCheckpoint(checkpoint, 2, 0, 0, binaryPattern, LUT, ranks, rng);
     }
     printf("\n");
 }
 
 // Phase 3: Continue with the last binary pattern, repeatedly find the tightest cluster of 0s and insert a 1 into them
-static void Phase3(std::vector<bool>& binaryPattern, std::vector<float>& LUT, std::vector<size_t>& ranks, size_t width, std::mt19937& rng)
+template <typename TBITS, typename TLUT, typename TRANKS>
+static void Phase3(TBITS& binaryPattern, TLUT& LUT, TRANKS& ranks, size_t width, size_t height, std::mt19937& rng, Checkpoint& checkpoint)
 {
     ScopedTimer timer("Phase 3", false);
 
     // count how many ones there are
-    size_t ones = 0;
-    for (bool b : binaryPattern)
-    {
-        if (b)
-            ones++;
-    }
+    size_t ones = CountOnes(binaryPattern);
     size_t startingOnes = ones;
-    size_t onesToDo = (width*width) - startingOnes;
+    size_t onesToDo = (width*height) - startingOnes;
 
     // add 1 to the largest cluster of 0's repeatedly
     int bestX, bestY;
@@ -527,60 +1110,322 @@ static void Phase3(std::vector<bool>& binaryPattern, std::vector<float>& LUT, st
         size_t onesDone = ones - startingOnes;
         printf("\r%i%%", int(100.0f * float(onesDone) / float(onesToDo)));
 
-        WriteLUTValue(LUT, width, true, bestX, bestY);
+        WriteLUTValue(LUT.data(), width, height, true, bestX, bestY);
         binaryPattern[bestY * width + bestX] = true;
-        ranks[bestY*width + bestX] = ones;
+        ranks[bestY*width + bestX] = uint32_t(ones);
         ones++;
+
+        if (checkpoint.Due())
+            SaveVoidClusterCheckpoint(checkpoint, 3, 0, 0, binaryPattern, LUT, ranks, rng);
     }
     printf("\n");
 }
 
-void GenerateBN_Void_Cluster(std::vector<uint8_t>& blueNoise, size_t width, bool useMitchellsBestCandidate, const char* baseFileName)
+// The containers for the state of void and cluster, either in memory, or in memory mapped files (VOIDCLUSTER_BACKING_STORE() in settings.h).
+// T is the type of the LUT: float, or int32_t or int16_t for fixed point.
+// The ranks are uint32, which is half the size of size_t, and is enough for masks up to 65536x65536.
+template <typename T>
+struct VoidClusterInMemory
 {
-    std::mt19937 rng(GetRNGSeed());
+    typedef std::vector<bool> TBITS;
+    typedef std::vector<T> TLUT;
+    typedef std::vector<uint32_t> TRANKS;
+};
 
-    std::vector<size_t> ranks(width*width, ~size_t(0));
+template <typename T>
+struct VoidClusterMapped
+{
+    typedef MappedBitVector TBITS;
+    typedef MappedVector<T> TLUT;
+    typedef MappedVector<uint32_t> TRANKS;
+};
 
-    std::vector<bool> initialBinaryPattern;
-    std::vector<bool> binaryPattern;
-    std::vector<float> initialLUT;
-    std::vector<float> LUT;
+template <typename T>
+static void SetBackingFile(std::vector<T>&, const std::string&)
+{
+}
 
-    if (!useMitchellsBestCandidate)
-    {
-        // make the initial binary pattern and initial LUT
-        MakeInitialBinaryPattern(initialBinaryPattern, width, baseFileName, rng);
-        MakeLUT(initialBinaryPattern, initialLUT, width, true);
+template <typename T>
+static void SetBackingFile(MappedVector<T>& values, const std::string& fileName)
+{
+    values.SetFileName(fileName);
+}
+
+static void SetBackingFile(MappedBitVector& values, const std::string& fileName)
+{
+    values.SetFileName(fileName);
+}
+
+template <typename T>
+static void RemoveBackingFile(std::vector<T>&)
+{
+}
+
+template <typename T>
+static void RemoveBackingFile(MappedVector<T>& values)
+{
+    values.Remove();
+}
 
-        // Phase 1: Start with initial binary pattern and remove the tightest cluster until there are none left, entering ranks for those pixels
-        binaryPattern = initialBinaryPattern;
-        LUT = initialLUT;
-        Phase1(binaryPattern, LUT, ranks, width, rng, baseFileName);
+static void RemoveBackingFile(MappedBitVector& values)
+{
+    values.Remove();
+}
+
+// the backing files are named after the last part of baseFileName, in VOIDCLUSTER_BACKING_STORE_DIRECTORY()
+static std::string GetBackingFileBase(const char* baseFileName)
+{
+    const char* name = baseFileName;
+    for (const char* c = baseFileName; *c; ++c)
+    {
+        if (*c == '/' || *c == '\\')
+            name = c + 1;
     }
+
+    MakeDirectory(VOIDCLUSTER_BACKING_STORE_DIRECTORY());
+
+    return std::string(VOIDCLUSTER_BACKING_STORE_DIRECTORY()) + "/" + name;
+}
+
+template <typename T, typename STORAGE>
+static void GenerateVoidCluster(std::vector<uint8_t>& blueNoise, size_t width, size_t height, VoidClusterInitialPattern initialPattern, const char* baseFileName, std::vector<size_t>* ranksOut, bool memoryLean, const std::string& backingFileBase, Checkpoint& checkpoint)
+{
+    std::mt19937 rng(GetRNGSeed());
+
+    typename STORAGE::TRANKS ranks;
+    typename STORAGE::TBITS initialBinaryPattern;
+    typename STORAGE::TBITS binaryPattern;
+    typename STORAGE::TLUT initialLUT;
+    typename STORAGE::TLUT LUT;
+    size_t initialOnes = 0;
+
+    SetBackingFile(ranks, backingFileBase + ".ranks");
+    SetBackingFile(initialBinaryPattern, backingFileBase + ".initialpattern");
+    SetBackingFile(binaryPattern, backingFileBase + ".pattern");
+    SetBackingFile(initialLUT, backingFileBase + ".initiallut");
+    SetBackingFile(LUT, backingFileBase + ".lut");
+
+    // pick up where an earlier run left off, if there is a checkpoint
+    int phase = 0;
+    int iterationCount = 0;
+    std::vector<uint64_t> recentPatterns;
+    bool resumed = LoadVoidClusterCheckpoint(checkpoint, width, height, phase, iterationCount, initialOnes, initialBinaryPattern, binaryPattern, LUT, ranks, rng, recentPatterns);
+    if (resumed)
+        printf("Resuming void and cluster in phase %i\n", phase);
     else
+        ranks.resize(width*height, ~uint32_t(0));
+
+    // Mitchell's best candidate makes progressive points, so it does phase 1's job too
+    const bool progressiveInitialPattern = initialPattern == VoidClusterInitialPattern::MitchellsBestCandidate;
+    if (!progressiveInitialPattern)
+    {
+        if (phase == 0)
+        {
+            // make the initial binary pattern. The LUT is used as scratch memory by the classic one.
+            switch (initialPattern)
+            {
+                case VoidClusterInitialPattern::PoissonDisk: PoissonDiskSampling(initialBinaryPattern, width, height, rng); break;
+                case VoidClusterInitialPattern::CapacityConstrainedVoronoi: CapacityConstrainedVoronoi(initialBinaryPattern, width, height, rng); break;
+                case VoidClusterInitialPattern::ThresholdedPaniq:
+                case VoidClusterInitialPattern::ThresholdedHPF:
+                {
+                    // a resumed run was in the middle of refining, so the thresholded points are already there
+                    if (!resumed)
+                        ThresholdedBlueNoise(initialBinaryPattern, width, height, initialPattern);
+                    if (VOIDCLUSTER_THRESHOLD_REFINE_ITERATIONS_PER_POINT() > 0.0f)
+                        MakeInitialBinaryPattern(initialBinaryPattern, LUT, ranks, width, height, baseFileName, rng, &checkpoint, resumed, iterationCount, recentPatterns, true, VOIDCLUSTER_THRESHOLD_REFINE_ITERATIONS_PER_POINT());
+                    break;
+                }
+                default: MakeInitialBinaryPattern(initialBinaryPattern, LUT, ranks, width, height, baseFileName, rng, &checkpoint, resumed, iterationCount, recentPatterns); break;
+            }
+            PrintMemoryUsage("Memory after initial pattern");
+
+            // Phase 1: Start with initial binary pattern and remove the tightest cluster until there are none left, entering ranks for those pixels.
+            // When memory lean, the initial pattern and LUT aren't kept for phase 2, since phase 1 ranks exactly the initial pattern's ones,
+            // so the pattern can be made again from the ranks, and the LUT from the pattern.
+            initialOnes = CountOnes(initialBinaryPattern);
+            if (memoryLean)
+            {
+                binaryPattern.swap(initialBinaryPattern);
+                MakeLUT(binaryPattern, LUT, width, height, true);
+            }
+            else
+            {
+                MakeLUT(initialBinaryPattern, initialLUT, width, height, true);
+                binaryPattern = initialBinaryPattern;
+                LUT = initialLUT;
+            }
+            phase = 1;
+        }
+        if (phase == 1)
+        {
+            Phase1(binaryPattern, LUT, ranks, initialOnes, width, height, rng, baseFileName, &checkpoint);
+            PrintMemoryUsage("Memory after phase 1");
+        }
+    }
+    else if (phase == 0)
     {
         // replace initial binary pattern and phase 1 with Mitchell's best candidate algorithm, and then making the LUT
-        MitchellsBestCandidate(initialBinaryPattern, ranks, width);
-        MakeLUT(initialBinaryPattern, initialLUT, width, true);
+        MitchellsBestCandidate(initialBinaryPattern, ranks, width, height);
+        MakeLUT(initialBinaryPattern, initialLUT, width, height, true);
+        PrintMemoryUsage("Memory after Mitchells best candidate");
 
-        //SaveBinaryPattern(initialBinaryPattern, width, "out/_blah", 0, -1, -1, -1, -1);
+        //SaveBinaryPattern(initialBinaryPattern, width, height, "out/_blah", 0, -1, -1, -1, -1);
     }
 
     // Phase 2: Start with initial binary pattern and add points to the largest void until half the pixels are white, entering ranks for those pixels
-    binaryPattern = initialBinaryPattern;
-    LUT = initialLUT;
-    Phase2(binaryPattern, LUT, ranks, width, rng);
+    if (phase <= 1)
+    {
+        // a resumed run might not have the initial pattern and LUT, so it makes them again like the memory lean path does
+        if (!progressiveInitialPattern && (memoryLean || resumed))
+        {
+            // the LUT is remade from scratch, which gives exactly what the initial LUT was
+            for (size_t index = 0; index < width*height; ++index)
+                binaryPattern[index] = ranks[index] < initialOnes;
+            MakeLUT(binaryPattern, LUT, width, height, true);
+        }
+        else
+        {
+            // the initial pattern and LUT aren't needed after this, so they are moved instead of copied
+            binaryPattern = std::move(initialBinaryPattern);
+            LUT = std::move(initialLUT);
+        }
+        phase = 2;
+    }
+    if (phase == 2)
+    {
+        Phase2(binaryPattern, LUT, ranks, width, height, rng, checkpoint);
+        PrintMemoryUsage("Memory after phase 2");
 
-    // Phase 3: Continue with the last binary pattern, repeatedly find the tightest cluster of 0s and insert a 1 into them
-    // Note: we do need to re-make the LUT, because we are writing 0s instead of 1s
-    MakeLUT(binaryPattern, LUT, width, false);
-    Phase3(binaryPattern, LUT, ranks, width, rng);
+        // Phase 3: Continue with the last binary pattern, repeatedly find the tightest cluster of 0s and insert a 1 into them
+        // Note: we do need to re-make the LUT, because we are writing 0s instead of 1s
+        MakeLUT(binaryPattern, LUT, width, height, false);
+        phase = 3;
+    }
+    Phase3(binaryPattern, LUT, ranks, width, height, rng, checkpoint);
+    PrintMemoryUsage("Memory after phase 3");
 
     // convert to U8
     {
         ScopedTimer timer("Converting to U8", false);
-        blueNoise.resize(width*width);
-        for (size_t index = 0; index < width*width; ++index)
-            blueNoise[index] = uint8_t(ranks[index] * 256 / (width*width));
+        QuantizeRanks(ranks, blueNoise);
+    }
+
+    if (ranksOut)
+        ranksOut->assign(ranks.data(), ranks.data() + ranks.size());
+
+    // the state isn't needed once the mask is made
+    checkpoint.Remove();
+    RemoveBackingFile(ranks);
+    RemoveBackingFile(initialBinaryPattern);
+    RemoveBackingFile(binaryPattern);
+    RemoveBackingFile(initialLUT);
+    RemoveBackingFile(LUT);
+}
+
+template <typename T>
+static void GenerateVoidCluster(std::vector<uint8_t>& blueNoise, size_t width, size_t height, VoidClusterInitialPattern initialPattern, const char* baseFileName, std::vector<size_t>* ranksOut, Checkpoint& checkpoint)
+{
+    // the backing store is always memory lean, since the point of it is to keep the working set small.
+    // The backing files are only working memory. They are made fresh each run, so resuming a stopped run needs checkpoints.
+    if (VOIDCLUSTER_BACKING_STORE())
+    {
+        if (!CHECKPOINT())
+            printf("The void and cluster backing store is not kept between runs. Turn on CHECKPOINT() to be able to resume a stopped run.\n");
+        GenerateVoidCluster<T, VoidClusterMapped<T>>(blueNoise, width, height, initialPattern, baseFileName, ranksOut, true, GetBackingFileBase(baseFileName), checkpoint);
+    }
+    else
+        GenerateVoidCluster<T, VoidClusterInMemory<T>>(blueNoise, width, height, initialPattern, baseFileName, ranksOut, VOIDCLUSTER_MEMORY_LEAN(), std::string(), checkpoint);
+}
+
+std::string GetVoidClusterParams(VoidClusterInitialPattern initialPattern, VoidClusterLUT LUTType)
+{
+    // the keys have the mask cache version in them too
+    char params[256];
+    sprintf(params, "initial=%i;lut=%i;maxiterations=%i;cyclewindow=%i;ccvd=%i;density=%f;paniq=%i;refine=%f",
+        int(initialPattern), int(LUTType), int(VOIDCLUSTER_INITIALBP_MAX_ITERATIONS_PER_POINT()), int(VOIDCLUSTER_INITIALBP_CYCLE_WINDOW()),
+        int(VOIDCLUSTER_CCVD_ITERATIONS()), float(VOIDCLUSTER_THRESHOLD_DENSITY()), int(VOIDCLUSTER_THRESHOLD_PANIQ_ITERATIONS()),
+        float(VOIDCLUSTER_THRESHOLD_REFINE_ITERATIONS_PER_POINT()));
+    return params;
+}
+
+void GenerateBN_Void_Cluster(std::vector<uint8_t>& blueNoise, size_t width, size_t height, VoidClusterInitialPattern initialPattern, const char* baseFileName, std::vector<size_t>* ranksOut, VoidClusterLUT LUTType)
+{
+    Checkpoint checkpoint("voidcluster", width, height, GetVoidClusterParams(initialPattern, LUTType).c_str());
+
+    switch (LUTType)
+    {
+        case VoidClusterLUT::Float: GenerateVoidCluster<float>(blueNoise, width, height, initialPattern, baseFileName, ranksOut, checkpoint); break;
+        case VoidClusterLUT::FixedPoint32: GenerateVoidCluster<int32_t>(blueNoise, width, height, initialPattern, baseFileName, ranksOut, checkpoint); break;
+        case VoidClusterLUT::FixedPoint16: GenerateVoidCluster<int16_t>(blueNoise, width, height, initialPattern, baseFileName, ranksOut, checkpoint); break;
+    }
+}
+
+template <typename T>
+static InitialPatternReport MakeVoidClusterInitialPattern(std::vector<bool>& binaryPattern, size_t width, size_t height, VoidClusterInitialPattern initialPattern)
+{
+    std::mt19937 rng(GetRNGSeed());
+    std::vector<T> LUT;
+    std::vector<uint32_t> ranks;
+    std::vector<uint64_t> recentPatterns;
+    binaryPattern.clear();
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    InitialPatternReport report;
+    switch (initialPattern)
+    {
+        case VoidClusterInitialPattern::MitchellsBestCandidate: MitchellsBestCandidate(binaryPattern, ranks, width, height); break;
+        case VoidClusterInitialPattern::PoissonDisk: PoissonDiskSampling(binaryPattern, width, height, rng); break;
+        case VoidClusterInitialPattern::CapacityConstrainedVoronoi: CapacityConstrainedVoronoi(binaryPattern, width, height, rng); break;
+        case VoidClusterInitialPattern::ThresholdedPaniq:
+        case VoidClusterInitialPattern::ThresholdedHPF:
+        {
+            ThresholdedBlueNoise(binaryPattern, width, height, initialPattern);
+            if (VOIDCLUSTER_THRESHOLD_REFINE_ITERATIONS_PER_POINT() > 0.0f)
+                report = MakeInitialBinaryPattern(binaryPattern, LUT, ranks, width, height, "out/_initialPattern", rng, nullptr, false, 0, recentPatterns, true, VOIDCLUSTER_THRESHOLD_REFINE_ITERATIONS_PER_POINT());
+            break;
+        }
+        default: report = MakeInitialBinaryPattern(binaryPattern, LUT, ranks, width, height, "out/_initialPattern", rng, nullptr, false, 0, recentPatterns); break;
+    }
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    report.seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    return report;
+}
+
+InitialPatternReport MakeVoidClusterInitialPattern(std::vector<bool>& binaryPattern, size_t width, size_t height, VoidClusterInitialPattern initialPattern, VoidClusterLUT LUTType)
+{
+    switch (LUTType)
+    {
+        case VoidClusterLUT::FixedPoint32: return MakeVoidClusterInitialPattern<int32_t>(binaryPattern, width, height, initialPattern);
+        case VoidClusterLUT::FixedPoint16: return MakeVoidClusterInitialPattern<int16_t>(binaryPattern, width, height, initialPattern);
+        default: return MakeVoidClusterInitialPattern<float>(binaryPattern, width, height, initialPattern);
+    }
+}
+
+template <typename T>
+static void ProgressivizeBinaryPattern(const std::vector<bool>& binaryPattern, size_t width, size_t height, std::vector<size_t>& ranks)
+{
+    std::mt19937 rng(GetRNGSeed());
+
+    // phase 1 removes the points, so it works on a copy
+    std::vector<bool> pattern = binaryPattern;
+    std::vector<T> LUT;
+    MakeLUT(pattern, LUT, width, height, true);
+
+    std::vector<uint32_t> pointRanks(width*height, ~uint32_t(0));
+    Phase1(pattern, LUT, pointRanks, CountOnes(pattern), width, height, rng, "out/_progressive", nullptr);
+
+    ranks.resize(width*height);
+    for (size_t index = 0; index < width*height; ++index)
+        ranks[index] = (pointRanks[index] == ~uint32_t(0)) ? ~size_t(0) : size_t(pointRanks[index]);
+}
+
+void ProgressivizeBinaryPattern(const std::vector<bool>& binaryPattern, size_t width, size_t height, std::vector<size_t>& ranks, VoidClusterLUT LUTType)
+{
+    switch (LUTType)
+    {
+        case VoidClusterLUT::FixedPoint32: ProgressivizeBinaryPattern<int32_t>(binaryPattern, width, height, ranks); break;
+        case VoidClusterLUT::FixedPoint16: ProgressivizeBinaryPattern<int16_t>(binaryPattern, width, height, ranks); break;
+        default: ProgressivizeBinaryPattern<float>(binaryPattern, width, height, ranks); break;
     }
 }
@@ -1,6 +1,68 @@
 #pragma once
 
+#include <stdint.h>
+#include <string>
 #include <vector>
 
 // http://cv.ulichney.com/papers/1993-void-cluster.pdf
-void GenerateBN_Void_Cluster(std::vector<uint8_t>& blueNoise, size_t width, bool useMitchellsBestCandidate, const char* baseFileName);
+// The type of the energy LUT.
+// The fixed point ones make updates exact, so removing a point undoes adding it and ties don't depend on rounding history,
+// and only the pixels the kernel doesn't round to 0 for are written, which is much faster.
+// FixedPoint16 halves the LUT's memory compared to the others, at the cost of a coarser kernel with more ties.
+enum class VoidClusterLUT
+{
+    Float,
+    FixedPoint32,
+    FixedPoint16
+};
+
+// Where the points that phase 1 ranks come from.
+// BinaryPattern is the paper's initial binary pattern, which starts with white noise and moves points from clusters to voids until it's stable.
+// MitchellsBestCandidate makes progressive points, so it replaces phase 1 too. It is fast, but leaves a + shape in the DFT.
+// PoissonDisk is Bridson's algorithm, which is fast. CapacityConstrainedVoronoi gives every point the same area, and each iteration is parallel.
+// ThresholdedPaniq and ThresholdedHPF threshold a mask from those generators at VOIDCLUSTER_THRESHOLD_DENSITY(), then refine it
+// like the initial binary pattern does, for VOIDCLUSTER_THRESHOLD_REFINE_ITERATIONS_PER_POINT() iterations per point.
+enum class VoidClusterInitialPattern
+{
+    BinaryPattern,
+    MitchellsBestCandidate,
+    PoissonDisk,
+    CapacityConstrainedVoronoi,
+    ThresholdedPaniq,
+    ThresholdedHPF
+};
+
+// If ranks isn't null, it gets the full precision rank of each pixel, from 0 to width*height-1.
+// The current and peak memory use are printed after each phase. VOIDCLUSTER_MEMORY_LEAN() in settings.h trades some time for memory.
+// VOIDCLUSTER_BACKING_STORE() keeps the state in memory mapped files, for masks too big to fit in memory.
+// With CHECKPOINT() on, a run that is stopped continues from its last checkpoint the next time, and makes the same mask.
+void GenerateBN_Void_Cluster(std::vector<uint8_t>& blueNoise, size_t width, size_t height, VoidClusterInitialPattern initialPattern, const char* baseFileName, std::vector<size_t>* ranksOut = nullptr, VoidClusterLUT LUTType = VoidClusterLUT::Float);
+
+// The initial pattern, LUT type and settings that change what GenerateBN_Void_Cluster makes, as a string for mask cache and checkpoint keys.
+std::string GetVoidClusterParams(VoidClusterInitialPattern initialPattern, VoidClusterLUT LUTType = VoidClusterLUT::Float);
+
+// How making void and cluster's initial binary pattern ended. It's done when the pattern is stable, but it also stops if it comes
+// back to a pattern it had recently, which means it is going around in a cycle, or after VOIDCLUSTER_INITIALBP_MAX_ITERATIONS_PER_POINT() iterations per point, so it always finishes.
+enum class InitialPatternOutcome
+{
+    Stable,
+    Cycle,
+    IterationLimit,
+    Refined // the thresholded initial patterns are only refined for VOIDCLUSTER_THRESHOLD_REFINE_ITERATIONS_PER_POINT(), not made stable
+};
+
+struct InitialPatternReport
+{
+    InitialPatternOutcome outcome = InitialPatternOutcome::Stable;
+    int iterations = 0;
+    int cycleLength = 0; // how many moves the cycle was, if it ended in one
+    double seconds = 0.0;
+};
+
+// Makes only the initial binary pattern, which is the slowest part of void and cluster, to see how long it takes to converge.
+// The iterations and outcome are only for VoidClusterInitialPattern::BinaryPattern, which is the only one that iterates until stable.
+InitialPatternReport MakeVoidClusterInitialPattern(std::vector<bool>& binaryPattern, size_t width, size_t height, VoidClusterInitialPattern initialPattern = VoidClusterInitialPattern::BinaryPattern, VoidClusterLUT LUTType = VoidClusterLUT::Float);
+
+// Phase 1 on its own. It ranks the 1s of any binary pattern, like Poisson disk points or a thresholded mask, so that the first N of
+// them are blue noise for any N. The 1s get ranks 0 to (number of 1s - 1), in the order to use them, and the 0s get ~size_t(0).
+void ProgressivizeBinaryPattern(const std::vector<bool>& binaryPattern, size_t width, size_t height, std::vector<size_t>& ranks, VoidClusterLUT LUTType = VoidClusterLUT::Float);
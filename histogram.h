@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include "output.h"
 
 template<typename T>
 void WriteHistogram(const std::vector<T>& values, const char* fileName)
@@ -10,10 +11,9 @@ void WriteHistogram(const std::vector<T>& values, const char* fileName)
     for (const T& value : values)
         histogram[value]++;
 
-    FILE * file = nullptr;
-    fopen_s(&file, fileName, "w+t");
-    fprintf(file, "\"Value\",\"Count\"\n");
+    std::string text;
+    AppendFormat(text, "\"Value\",\"Count\"\n");
     for (size_t index = 0, count = histogram.size(); index < count; ++index)
-        fprintf(file, "\"%zu\",\"%zu\"\n", index, histogram[index]);
-    fclose(file);
-}
\ No newline at end of file
+        AppendFormat(text, "\"%zu\",\"%zu\"\n", index, histogram[index]);
+    GetOutputQueue().WriteText(fileName, std::move(text));
+}
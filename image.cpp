@@ -33,6 +33,6 @@ void AppendImageHorizontal(
         const uint8_t* srcptr = &srcB[y*widthB];
         uint8_t* destptr = &dest[y*destWidth + widthA];
 
-        memcpy(destptr, srcptr, widthA);
+        memcpy(destptr, srcptr, widthB);
     }
 }
\ No newline at end of file
@@ -1,7 +1,127 @@
 #pragma once
 
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
 #include <vector>
 
+#include "aligned.h"
+
+// A view of a 2D image that doesn't own the pixels. Rows are m_stride elements apart, so a view can be a window into a bigger image,
+// which lets things like composites be made by writing straight into part of the destination instead of copying.
+template <typename T>
+struct ImageView
+{
+    ImageView() {}
+
+    ImageView(T* pixels_, size_t width, size_t height, size_t stride)
+        : pixels(pixels_)
+        , m_width(width)
+        , m_height(height)
+        , m_stride(stride)
+    {
+    }
+
+    // a view of non const pixels can be used as a view of const pixels
+    template <typename U>
+    ImageView(const ImageView<U>& other)
+        : pixels(other.pixels)
+        , m_width(other.m_width)
+        , m_height(other.m_height)
+        , m_stride(other.m_stride)
+    {
+    }
+
+    T* Row(size_t y) const
+    {
+        return &pixels[y*m_stride];
+    }
+
+    T& operator()(size_t x, size_t y) const
+    {
+        return pixels[y*m_stride + x];
+    }
+
+    ImageView SubView(size_t x, size_t y, size_t width, size_t height) const
+    {
+        return ImageView(&pixels[y*m_stride + x], width, height, m_stride);
+    }
+
+    T* pixels = nullptr;
+    size_t m_width = 0;
+    size_t m_height = 0;
+    size_t m_stride = 0;
+};
+
+// An image that owns its pixels. The storage is 64 byte aligned, and rows are padded to a multiple of 64 bytes so every row is aligned too.
+template <typename T>
+struct Image
+{
+    Image() {}
+
+    Image(size_t width, size_t height, T fill = T())
+    {
+        Resize(width, height, fill);
+    }
+
+    void Resize(size_t width, size_t height, T fill = T())
+    {
+        const size_t c_rowAlignment = (64 % sizeof(T) == 0) ? 64 / sizeof(T) : 1;
+        m_width = width;
+        m_height = height;
+        m_stride = ((width + c_rowAlignment - 1) / c_rowAlignment) * c_rowAlignment;
+        pixels.assign(m_stride * height, fill);
+    }
+
+    ImageView<T> View()
+    {
+        return ImageView<T>(pixels.data(), m_width, m_height, m_stride);
+    }
+
+    ImageView<const T> View() const
+    {
+        return ImageView<const T>(pixels.data(), m_width, m_height, m_stride);
+    }
+
+    T& operator()(size_t x, size_t y)
+    {
+        return pixels[y*m_stride + x];
+    }
+
+    const T& operator()(size_t x, size_t y) const
+    {
+        return pixels[y*m_stride + x];
+    }
+
+    size_t m_width = 0;
+    size_t m_height = 0;
+    size_t m_stride = 0;
+    AlignedVector<T> pixels;
+};
+
+// views of the tightly packed images that the generators make
+template <typename T>
+ImageView<T> MakeImageView(std::vector<T>& pixels, size_t width, size_t height)
+{
+    return ImageView<T>(pixels.data(), width, height, width);
+}
+
+template <typename T>
+ImageView<const T> MakeImageView(const std::vector<T>& pixels, size_t width, size_t height)
+{
+    return ImageView<const T>(pixels.data(), width, height, width);
+}
+
+// copies the overlapping part of src into dest. src can be a view of T or const T.
+template <typename TSRC, typename T>
+void CopyImage(const ImageView<TSRC>& src, const ImageView<T>& dest)
+{
+    size_t width = std::min(src.m_width, dest.m_width);
+    size_t height = std::min(src.m_height, dest.m_height);
+    for (size_t y = 0; y < height; ++y)
+        memcpy(dest.Row(y), src.Row(y), width * sizeof(T));
+}
+
 void AppendImageHorizontal(
     const std::vector<uint8_t>& srcA,
     size_t widthA,
@@ -12,4 +132,4 @@ void AppendImageHorizontal(
     std::vector<uint8_t>& dest,
     size_t& destWidth,
     size_t& destHeight
-);
\ No newline at end of file
+);
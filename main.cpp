@@ -2,8 +2,12 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <omp.h>
 #include <vector>
 
+#include "blur.h"
 #include "convert.h"
 #include "dft.h"
 #include "generatebn_frs.h"
@@ -14,9 +18,13 @@
 #include "generatebn_void_cluster.h"
 #include "histogram.h"
 #include "image.h"
+#include "maskcache.h"
 #include "misc.h"
+#include "output.h"
+#include "ranks.h"
 #include "whitenoise.h"
 #include "scoped_timer.h"
+#include "spectrum.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
@@ -24,10 +32,10 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 
-void TestMask(const std::vector<uint8_t>& noise, size_t noiseSize, const char* baseFileName)
+void TestMask(const std::vector<uint8_t>& noise, size_t width, size_t height, const char* baseFileName)
 {
-    std::vector<uint8_t> thresholdImage(noise.size());
-
+    // get the list of threshold values, skipping duplicates
+    std::vector<uint8_t> thresholdValues;
     for (size_t testIndex = 0; testIndex < THRESHOLD_SAMPLES(); ++testIndex)
     {
         float percent = float(testIndex) / float(THRESHOLD_SAMPLES() - 1);
@@ -37,45 +45,586 @@ void TestMask(const std::vector<uint8_t>& noise, size_t noiseSize, const char* b
         else if (thresholdValue == 255)
             thresholdValue = 254;
 
-        for (size_t pixelIndex = 0, pixelCount = noise.size(); pixelIndex < pixelCount; ++pixelIndex)
-            thresholdImage[pixelIndex] = noise[pixelIndex] > thresholdValue ? 255 : 0;
-
-        std::vector<uint8_t> thresholdImageDFT;
-        DFT(thresholdImage, thresholdImageDFT, noiseSize);
+        if (thresholdValues.empty() || thresholdValues.back() != thresholdValue)
+            thresholdValues.push_back(thresholdValue);
+    }
+    const size_t thresholdCount = thresholdValues.size();
+    const size_t pixelCount = noise.size();
+
+    // make all of the thresholded images in a single pass over the noise.
+    // Each one goes in the left half of the image that gets saved, and its DFT goes in the right half, so nothing is copied.
+    std::vector<Image<uint8_t>> thresholdImages(thresholdCount, Image<uint8_t>(width * 2, height));
+    #pragma omp parallel for
+    for (int pixelIndex = 0; pixelIndex < int(pixelCount); ++pixelIndex)
+    {
+        size_t x = size_t(pixelIndex) % width;
+        size_t y = size_t(pixelIndex) / width;
+        uint8_t value = noise[pixelIndex];
+        for (size_t thresholdIndex = 0; thresholdIndex < thresholdCount; ++thresholdIndex)
+            thresholdImages[thresholdIndex](x, y) = value > thresholdValues[thresholdIndex] ? 255 : 0;
+    }
 
-        std::vector<uint8_t> noiseAndDFT;
-        size_t noiseAndDFT_width = 0;
-        size_t noiseAndDFT_height = 0;
-        AppendImageHorizontal(thresholdImage, noiseSize, noiseSize, thresholdImageDFT, noiseSize, noiseSize, noiseAndDFT, noiseAndDFT_width, noiseAndDFT_height);
+    // DFT and get the metrics for each threshold in parallel, and queue the images to be written in the background
+    std::vector<SpectralMetrics> metrics(thresholdCount);
+    #pragma omp parallel for
+    for (int thresholdIndex = 0; thresholdIndex < int(thresholdCount); ++thresholdIndex)
+    {
+        ImageView<uint8_t> view = thresholdImages[thresholdIndex].View();
+        ImageView<const uint8_t> thresholdImage = view.SubView(0, 0, width, height);
+        DFT(thresholdImage, view.SubView(width, 0, width, height), &metrics[thresholdIndex]);
 
         char fileName[256];
-        sprintf(fileName, "%s_%u.png", baseFileName, thresholdValue);
-        stbi_write_png(fileName, int(noiseAndDFT_width), int(noiseAndDFT_height), 1, noiseAndDFT.data(), 0);
+        sprintf(fileName, "%s_%u.png", baseFileName, thresholdValues[thresholdIndex]);
+        GetOutputQueue().WritePNG(fileName, std::move(thresholdImages[thresholdIndex]));
     }
+
+    // the spectral metrics summary of each threshold goes into a csv
+    std::string csv;
+    AppendFormat(csv, "\"Threshold\",\"Low Frequency Energy\",\"Mean Anisotropy\"\n");
+    for (size_t thresholdIndex = 0; thresholdIndex < thresholdCount; ++thresholdIndex)
+    {
+        // skip DC when averaging anisotropy
+        const SpectralMetrics& m = metrics[thresholdIndex];
+        float meanAnisotropy = 0.0f;
+        for (size_t index = 1, count = m.anisotropy.size(); index < count; ++index)
+            meanAnisotropy += m.anisotropy[index] / float(count - 1);
+        AppendFormat(csv, "\"%u\",\"%f\",\"%f\"\n", thresholdValues[thresholdIndex], m.lowFrequencyEnergy, meanAnisotropy);
+    }
+
+    char csvFileName[256];
+    sprintf(csvFileName, "%s.thresholds.csv", baseFileName);
+    GetOutputQueue().WriteText(csvFileName, std::move(csv));
 }
 
-void TestNoise(const std::vector<uint8_t>& noise, size_t noiseSize, const char* baseFileName)
+void TestNoise(const std::vector<uint8_t>& noise, size_t width, size_t height, const char* baseFileName)
 {
     char fileName[256];
     sprintf(fileName, "%s.histogram.csv", baseFileName);
 
     WriteHistogram(noise, fileName);
-    std::vector<uint8_t> noiseDFT;
-    DFT(noise, noiseDFT, noiseSize);
 
-    std::vector<uint8_t> noiseAndDFT;
-    size_t noiseAndDFT_width = 0;
-    size_t noiseAndDFT_height = 0;
-    AppendImageHorizontal(noise, noiseSize, noiseSize, noiseDFT, noiseSize, noiseSize, noiseAndDFT, noiseAndDFT_width, noiseAndDFT_height);
+    // the noise goes on the left of the image that gets saved, and the DFT is written straight into the right
+    Image<uint8_t> noiseAndDFT(width * 2, height);
+    ImageView<uint8_t> noiseAndDFTView = noiseAndDFT.View();
+    CopyImage(MakeImageView(noise, width, height), noiseAndDFTView.SubView(0, 0, width, height));
+
+    SpectralMetrics metrics;
+    DFT(MakeImageView(noise, width, height), noiseAndDFTView.SubView(width, 0, width, height), &metrics);
+
+    char jsonFileName[256];
+    sprintf(fileName, "%s.spectrum.csv", baseFileName);
+    sprintf(jsonFileName, "%s.spectrum.json", baseFileName);
+    WriteSpectralMetrics(metrics, fileName, jsonFileName);
+
+    // the spectral metrics of every threshold level
+    {
+        std::vector<SpectralMetrics> levelMetrics;
+        {
+            ScopedTimer timer("Spectral metrics of all threshold levels");
+            CalculateThresholdSpectralMetrics(noise, width, height, SPECTRUM_LOW_FREQUENCY_CUTOFF(), levelMetrics);
+        }
+
+        std::string csv;
+        AppendFormat(csv, "\"Threshold\",\"Low Frequency Energy\",\"Mean Anisotropy\"\n");
+        for (size_t threshold = 0; threshold < levelMetrics.size(); ++threshold)
+        {
+            // skip DC when averaging anisotropy
+            const SpectralMetrics& m = levelMetrics[threshold];
+            float meanAnisotropy = 0.0f;
+            for (size_t index = 1, count = m.anisotropy.size(); index < count; ++index)
+                meanAnisotropy += m.anisotropy[index] / float(count - 1);
+            AppendFormat(csv, "\"%zu\",\"%f\",\"%f\"\n", threshold, m.lowFrequencyEnergy, meanAnisotropy);
+        }
+
+        sprintf(fileName, "%s.levels.csv", baseFileName);
+        GetOutputQueue().WriteText(fileName, std::move(csv));
+    }
 
     sprintf(fileName, "%s.png", baseFileName);
-    stbi_write_png(fileName, int(noiseAndDFT_width), int(noiseAndDFT_height), 1, noiseAndDFT.data(), 0);
+    GetOutputQueue().WritePNG(fileName, std::move(noiseAndDFT));
+
+    TestMask(noise, width, height, baseFileName);
+}
+
+void TestBlur(size_t width, const char* csvFileName)
+{
+    // compare the recursive gaussian blur against the direct separable one, for speed and accuracy
+    std::mt19937 rng(GetRNGSeed());
+    std::vector<float> noise;
+    MakeWhiteNoiseFloat(rng, noise, width);
+
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName, "w+t");
+    fprintf(file, "\"Sigma\",\"Direct ms\",\"Recursive ms\",\"Max Error\",\"RMS Error\"\n");
+
+    static const float c_sigmas[] = { 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 32.0f };
+    for (float sigma : c_sigmas)
+    {
+        std::vector<float> direct, recursive;
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        GaussianBlur(noise, direct, width, sigma);
+        std::chrono::high_resolution_clock::time_point middle = std::chrono::high_resolution_clock::now();
+        GaussianBlurRecursive(noise, recursive, width, sigma);
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+        double directMs = std::chrono::duration_cast<std::chrono::duration<double>>(middle - start).count() * 1000.0;
+        double recursiveMs = std::chrono::duration_cast<std::chrono::duration<double>>(end - middle).count() * 1000.0;
+
+        double maxError = 0.0;
+        double sumSquaredError = 0.0;
+        for (size_t index = 0, count = direct.size(); index < count; ++index)
+        {
+            double error = std::abs(double(direct[index]) - double(recursive[index]));
+            maxError = std::max(maxError, error);
+            sumSquaredError += error * error;
+        }
+        double rmsError = sqrt(sumSquaredError / double(direct.size()));
+
+        printf("sigma %0.1f: direct %0.2f ms, recursive %0.2f ms, max error %f, rms error %f\n", sigma, directMs, recursiveMs, maxError, rmsError);
+        fprintf(file, "\"%f\",\"%f\",\"%f\",\"%f\",\"%f\"\n", sigma, directMs, recursiveMs, maxError, rmsError);
+    }
+    printf("\n");
+
+    fclose(file);
+}
+
+void TestFFT(const char* csvFileName)
+{
+    // compare the float real input FFT against simple_fft, for speed and accuracy
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName, "w+t");
+    fprintf(file, "\"Width\",\"simple_fft ms\",\"RealFFT2D ms\",\"Speedup\",\"Max Relative Error\"\n");
+
+    std::mt19937 rng(GetRNGSeed());
+    for (size_t width = 256; width <= 2048; width *= 2)
+    {
+        std::vector<float> noise;
+        MakeWhiteNoiseFloat(rng, noise, width);
+
+        ComplexImage2D complexImageIn(width, width);
+        ComplexImage2D complexImageOut(width, width);
+        for (size_t index = 0, count = width * width; index < count; ++index)
+            complexImageIn.pixels[index] = noise[index];
+
+        // run RealFFT2D once first so the timing doesn't include making the plans
+        std::vector<float> power;
+        PowerSpectrum2D(noise.data(), width, width, power);
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        const char* error = nullptr;
+        simple_fft::FFT(complexImageIn, complexImageOut, width, width, error);
+        std::chrono::high_resolution_clock::time_point middle = std::chrono::high_resolution_clock::now();
+        PowerSpectrum2D(noise.data(), width, width, power);
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+        double simpleMs = std::chrono::duration_cast<std::chrono::duration<double>>(middle - start).count() * 1000.0;
+        double realMs = std::chrono::duration_cast<std::chrono::duration<double>>(end - middle).count() * 1000.0;
+
+        // the error is relative to the largest power, which is DC
+        double maxPower = 0.0;
+        for (const complex_type& c : complexImageOut.pixels)
+            maxPower = std::max(maxPower, double(std::norm(c)));
+        double maxError = 0.0;
+        for (size_t index = 0, count = width * width; index < count; ++index)
+            maxError = std::max(maxError, std::abs(double(std::norm(complexImageOut.pixels[index])) - double(power[index])) / maxPower);
+
+        printf("%zux%zu: simple_fft %0.2f ms, RealFFT2D %0.2f ms, %0.2fx faster, max relative error %g\n", width, width, simpleMs, realMs, simpleMs / realMs, maxError);
+        fprintf(file, "\"%zu\",\"%f\",\"%f\",\"%f\",\"%g\"\n", width, simpleMs, realMs, simpleMs / realMs, maxError);
+    }
+    printf("\n");
+
+    fclose(file);
+}
+
+// a 1D DFT done directly in double, as a reference for the FFTs
+static void ReferenceDFT(const std::complex<double>* src, size_t count, size_t stride, std::complex<double>* dest)
+{
+    const double c_pi = 3.14159265358979323846;
+    std::vector<std::complex<double>> roots(count);
+    for (size_t k = 0; k < count; ++k)
+        roots[k] = std::polar(1.0, -2.0 * c_pi * double(k) / double(count));
+
+    for (size_t k = 0; k < count; ++k)
+    {
+        std::complex<double> sum = 0.0;
+        size_t rootIndex = 0;
+        for (size_t n = 0; n < count; ++n)
+        {
+            sum += src[n * stride] * roots[rootIndex];
+            rootIndex = (rootIndex + k) % count;
+        }
+        dest[k * stride] = sum;
+    }
+}
+
+void TestFFTSizes(const char* csvFileName)
+{
+    // time the FFT at sizes that aren't powers of two, and check it against a direct DFT done in double.
+    // 96, 270, 360, 480 and 640 only have factors of 2, 3 and 5 so use the mixed radix FFT. 89, 97, 127 and 251 are prime so use Bluestein's algorithm.
+    static const size_t c_sizes[][2] = { { 256, 256 }, { 96, 96 }, { 480, 270 }, { 640, 360 }, { 97, 89 }, { 251, 127 } };
+
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName, "w+t");
+    fprintf(file, "\"Width\",\"Height\",\"ms\",\"ns per pixel per log2 pixels\",\"Max Relative Error\",\"DC Relative Error\"\n");
+
+    std::mt19937 rng(GetRNGSeed());
+    for (const size_t* size : c_sizes)
+    {
+        const size_t width = size[0];
+        const size_t height = size[1];
+
+        std::vector<float> noise;
+        MakeWhiteNoiseFloat(rng, noise, width, height);
+
+        // once to make the plans, once to time
+        std::vector<float> power;
+        PowerSpectrum2D(noise.data(), width, height, power);
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        PowerSpectrum2D(noise.data(), width, height, power);
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+        double nsPerPixelLog2 = ms * 1000000.0 / (double(width * height) * log2(double(width * height)));
+
+        // the reference is a direct DFT of the rows, then of the columns
+        std::vector<std::complex<double>> reference(width * height);
+        std::vector<std::complex<double>> temp(width * height);
+        for (size_t index = 0; index < width * height; ++index)
+            temp[index] = noise[index];
+        #pragma omp parallel for
+        for (int y = 0; y < int(height); ++y)
+            ReferenceDFT(&temp[y * width], width, 1, &reference[y * width]);
+        #pragma omp parallel for
+        for (int x = 0; x < int(width); ++x)
+            ReferenceDFT(&reference[x], height, width, &temp[x]);
+
+        // DC is much bigger than the other frequencies, so it has its own error, relative to itself.
+        // The other frequencies' errors are relative to their mean power, so that DC doesn't hide them.
+        const size_t count = width * height;
+        double meanPower = 0.0;
+        for (size_t index = 1; index < count; ++index)
+            meanPower += std::norm(temp[index]) / double(count - 1);
+        double maxError = 0.0;
+        for (size_t index = 1; index < count; ++index)
+            maxError = std::max(maxError, std::abs(std::norm(temp[index]) - double(power[index])) / meanPower);
+        double dcError = std::abs(std::norm(temp[0]) - double(power[0])) / std::norm(temp[0]);
+
+        printf("%zux%zu: %0.2f ms, %0.3f ns per pixel per log2 pixels, max relative error %g, DC relative error %g\n", width, height, ms, nsPerPixelLog2, maxError, dcError);
+        fprintf(file, "\"%zu\",\"%zu\",\"%f\",\"%f\",\"%g\",\"%g\"\n", width, height, ms, nsPerPixelLog2, maxError, dcError);
+    }
+    printf("\n");
+
+    fclose(file);
+}
+
+void TestFFTScaling(size_t width, const char* csvFileName)
+{
+    // time RealFFT2D at different thread counts
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName, "w+t");
+    fprintf(file, "\"Threads\",\"ms\",\"Speedup\"\n");
+
+    std::mt19937 rng(GetRNGSeed());
+    std::vector<float> noise;
+    MakeWhiteNoiseFloat(rng, noise, width);
+
+    AlignedVector<ComplexFloat> spectrum;
+    AlignedVector<ComplexFloat> firstSpectrum;
+
+    const int maxThreads = omp_get_max_threads();
+    double singleThreadMs = 0.0;
+    for (int threads = 1; threads <= 32; threads *= 2)
+    {
+        omp_set_num_threads(threads);
+
+        // once to warm up, once to time
+        RealFFT2D(noise.data(), width, width, spectrum);
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        RealFFT2D(noise.data(), width, width, spectrum);
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+        double ms = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count() * 1000.0;
+        if (threads == 1)
+        {
+            singleThreadMs = ms;
+            firstSpectrum = spectrum;
+        }
+
+        // the results should be the same no matter how many threads there are
+        bool identical = (spectrum == firstSpectrum);
+
+        printf("%i threads: %0.2f ms, %0.2fx%s\n", threads, ms, singleThreadMs / ms, identical ? "" : " (RESULTS DIFFER!)");
+        fprintf(file, "\"%i\",\"%f\",\"%f\"\n", threads, ms, singleThreadMs / ms);
+    }
+    printf("\n");
+
+    omp_set_num_threads(maxThreads);
+    fclose(file);
+}
+
+void TestInitialPatternConvergence(const char* csvFileName)
+{
+    // how many iterations void and cluster's initial binary pattern takes to be stable at different sizes, with the float and fixed point LUTs
+    static const size_t c_widths[] = { 16, 32, 64, 128, 256 };
+    static const VoidClusterLUT c_LUTTypes[] = { VoidClusterLUT::Float, VoidClusterLUT::FixedPoint32 };
+    static const char* c_LUTNames[] = { "Float", "FixedPoint32" };
+    static const char* c_outcomeNames[] = { "Stable", "Cycle", "Iteration Limit", "Refined" };
+
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName, "w+t");
+    fprintf(file, "\"Width\",\"LUT\",\"Iterations\",\"Iterations Per Point\",\"Outcome\",\"Cycle Length\",\"ms\"\n");
+
+    for (size_t width : c_widths)
+    {
+        for (size_t LUTIndex = 0; LUTIndex < 2; ++LUTIndex)
+        {
+            std::vector<bool> binaryPattern;
+            InitialPatternReport report = MakeVoidClusterInitialPattern(binaryPattern, width, width, VoidClusterInitialPattern::BinaryPattern, c_LUTTypes[LUTIndex]);
+
+            size_t ones = 0;
+            for (bool b : binaryPattern)
+                ones += b ? 1 : 0;
+
+            fprintf(file, "\"%zu\",\"%s\",\"%i\",\"%f\",\"%s\",\"%i\",\"%f\"\n", width, c_LUTNames[LUTIndex], report.iterations,
+                double(report.iterations) / double(ones), c_outcomeNames[int(report.outcome)], report.cycleLength, report.seconds * 1000.0);
+        }
+    }
+    printf("\n");
+
+    fclose(file);
+}
+
+void TestInitialPatterns(size_t width, const char* csvFileName)
+{
+    // compare the initial binary patterns void and cluster can start from: how long they take, how blue they are, and how blue the final mask is
+    static const VoidClusterInitialPattern c_patterns[] = { VoidClusterInitialPattern::BinaryPattern, VoidClusterInitialPattern::MitchellsBestCandidate, VoidClusterInitialPattern::PoissonDisk, VoidClusterInitialPattern::CapacityConstrainedVoronoi,
+        VoidClusterInitialPattern::ThresholdedPaniq, VoidClusterInitialPattern::ThresholdedHPF };
+    static const char* c_patternNames[] = { "BinaryPattern", "MitchellsBestCandidate", "PoissonDisk", "CapacityConstrainedVoronoi", "ThresholdedPaniq", "ThresholdedHPF" };
+
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName, "w+t");
+    fprintf(file, "\"Initial Pattern\",\"Points\",\"Initial Pattern ms\",\"Initial Pattern Low Frequency Energy\",\"Initial Pattern Mean Anisotropy\",\"Void And Cluster ms\",\"Mask Mean Low Frequency Energy\",\"Mask Mean Anisotropy\"\n");
+
+    for (size_t patternIndex = 0; patternIndex < sizeof(c_patterns) / sizeof(c_patterns[0]); ++patternIndex)
+    {
+        printf("%s...\n", c_patternNames[patternIndex]);
+
+        std::vector<bool> binaryPattern;
+        InitialPatternReport report = MakeVoidClusterInitialPattern(binaryPattern, width, width, c_patterns[patternIndex]);
+
+        // the initial pattern and its DFT side by side
+        std::vector<uint8_t> pattern(binaryPattern.size());
+        size_t ones = 0;
+        for (size_t index = 0; index < binaryPattern.size(); ++index)
+        {
+            pattern[index] = binaryPattern[index] ? 255 : 0;
+            ones += binaryPattern[index] ? 1 : 0;
+        }
+        Image<uint8_t> patternAndDFT(width * 2, width);
+        ImageView<uint8_t> patternAndDFTView = patternAndDFT.View();
+        CopyImage(MakeImageView(pattern, width, width), patternAndDFTView.SubView(0, 0, width, width));
+        SpectralMetrics patternMetrics;
+        DFT(MakeImageView(pattern, width, width), patternAndDFTView.SubView(width, 0, width, width), &patternMetrics);
+
+        char fileName[256];
+        sprintf(fileName, "out/initialPattern_%s.png", c_patternNames[patternIndex]);
+        GetOutputQueue().WritePNG(fileName, std::move(patternAndDFT));
+
+        float patternAnisotropy = 0.0f;
+        for (size_t index = 1, count = patternMetrics.anisotropy.size(); index < count; ++index)
+            patternAnisotropy += patternMetrics.anisotropy[index] / float(count - 1);
+
+        // the whole void and cluster mask, and the average of its spectral metrics over every threshold level
+        std::vector<uint8_t> noise;
+        sprintf(fileName, "out/initialPattern_%s_VC", c_patternNames[patternIndex]);
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        GenerateBN_Void_Cluster(noise, width, width, c_patterns[patternIndex], fileName);
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        double voidClusterSeconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        std::vector<SpectralMetrics> levelMetrics;
+        CalculateThresholdSpectralMetrics(noise, width, width, SPECTRUM_LOW_FREQUENCY_CUTOFF(), levelMetrics);
+        double maskLowFrequencyEnergy = 0.0;
+        double maskAnisotropy = 0.0;
+        for (const SpectralMetrics& m : levelMetrics)
+        {
+            maskLowFrequencyEnergy += m.lowFrequencyEnergy / double(levelMetrics.size());
+            for (size_t index = 1, count = m.anisotropy.size(); index < count; ++index)
+                maskAnisotropy += m.anisotropy[index] / double((count - 1) * levelMetrics.size());
+        }
+
+        fprintf(file, "\"%s\",\"%zu\",\"%f\",\"%f\",\"%f\",\"%f\",\"%f\",\"%f\"\n", c_patternNames[patternIndex], ones, report.seconds * 1000.0,
+            patternMetrics.lowFrequencyEnergy, patternAnisotropy, voidClusterSeconds * 1000.0, maskLowFrequencyEnergy, maskAnisotropy);
+    }
+    printf("\n");
+
+    fclose(file);
+}
+
+// the low frequency energy of the first count points of order
+static float PointsLowFrequencyEnergy(const std::vector<size_t>& order, size_t count, size_t width)
+{
+    std::vector<uint8_t> points(width * width, 0);
+    for (size_t index = 0; index < count; ++index)
+        points[order[index]] = 255;
+
+    Image<uint8_t> dft(width, width);
+    SpectralMetrics metrics;
+    DFT(MakeImageView(points, width, width), dft.View(), &metrics);
+    return metrics.lowFrequencyEnergy;
+}
+
+// the pixels with ranks, sorted by rank. Ties, like the 8 bit values of a mask, are put in a random order, since breaking them
+// in pixel order would make the first points of each value a row of the image, and make the original order look worse than it is.
+static std::vector<size_t> RankOrder(const std::vector<size_t>& ranks, std::mt19937& rng)
+{
+    std::vector<size_t> order;
+    for (size_t index = 0; index < ranks.size(); ++index)
+    {
+        if (ranks[index] != ~size_t(0))
+            order.push_back(index);
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    std::stable_sort(order.begin(), order.end(), [&ranks](size_t a, size_t b) { return ranks[a] < ranks[b]; });
+    return order;
+}
+
+void TestProgressivize(size_t width, const char* inputFileName, const char* csvFileName)
+{
+    // makes points from a few fast generators progressive with void and cluster's phase 1, and checks how blue the first part of them is.
+    // Thresholded masks already have an order, from their values, so that is compared too.
+    // The points of the thresholded masks are the VOIDCLUSTER_THRESHOLD_DENSITY() fraction of pixels with the lowest values.
+    static const char* c_sourceNames[] = { "PoissonDisk", "ThresholdedHPF", "ThresholdedFRS", "ThresholdedFile" };
+    static const float c_fractions[] = { 0.125f, 0.25f, 0.5f, 1.0f };
+    const size_t pixelCount = width * width;
+    const size_t thresholdU8 = size_t(VOIDCLUSTER_THRESHOLD_DENSITY() * 256.0f + 0.5f);
+    std::mt19937 rng(GetRNGSeed());
+
+    FILE* file = nullptr;
+    fopen_s(&file, csvFileName, "w+t");
+    fprintf(file, "\"Source\",\"Points\",\"Progressivize ms\",\"Fraction\",\"Low Frequency Energy\",\"Original Order Low Frequency Energy\"\n");
+
+    for (size_t sourceIndex = 0; sourceIndex < sizeof(c_sourceNames) / sizeof(c_sourceNames[0]); ++sourceIndex)
+    {
+        // originalRanks is left empty if the points don't have an order
+        std::vector<bool> binaryPattern;
+        std::vector<size_t> originalRanks;
+        size_t threshold = 0;
+        switch (sourceIndex)
+        {
+            case 0:
+            {
+                MakeVoidClusterInitialPattern(binaryPattern, width, width, VoidClusterInitialPattern::PoissonDisk);
+                break;
+            }
+            case 1:
+            {
+                std::vector<uint8_t> noise;
+                GenerateBN_HPF(noise, width, width);
+                originalRanks.assign(noise.begin(), noise.end());
+                threshold = thresholdU8;
+                break;
+            }
+            case 2:
+            {
+                std::vector<uint8_t> noise;
+                GenerateBN_FRS(noise, width, width, true, &originalRanks);
+                threshold = size_t(float(pixelCount) * VOIDCLUSTER_THRESHOLD_DENSITY() + 0.5f);
+                break;
+            }
+            case 3:
+            {
+                // a mask of the right size. Masks like bluenoise256.png have a different mask in each channel, so only the first is used.
+                int imageWidth, imageHeight, channels;
+                uint8_t* image = stbi_load(inputFileName, &imageWidth, &imageHeight, &channels, 0);
+                if (!image)
+                    break;
+                if (size_t(imageWidth) == width && size_t(imageHeight) == width)
+                {
+                    originalRanks.resize(pixelCount);
+                    for (size_t index = 0; index < pixelCount; ++index)
+                        originalRanks[index] = image[index * channels];
+                    threshold = thresholdU8;
+                }
+                stbi_image_free(image);
+                break;
+            }
+        }
+
+        // thresholded masks keep their lowest values
+        if (!originalRanks.empty())
+        {
+            binaryPattern.resize(pixelCount);
+            for (size_t index = 0; index < pixelCount; ++index)
+            {
+                binaryPattern[index] = originalRanks[index] < threshold;
+                if (!binaryPattern[index])
+                    originalRanks[index] = ~size_t(0);
+            }
+        }
+
+        if (binaryPattern.empty())
+        {
+            printf("%s: no points\n", c_sourceNames[sourceIndex]);
+            continue;
+        }
 
-    TestMask(noise, noiseSize, baseFileName);
+        printf("%s...\n", c_sourceNames[sourceIndex]);
+        std::vector<size_t> ranks;
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        ProgressivizeBinaryPattern(binaryPattern, width, width, ranks, VoidClusterLUT::FixedPoint32);
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        std::vector<size_t> order = RankOrder(ranks, rng);
+        std::vector<size_t> originalOrder = RankOrder(originalRanks, rng);
+        for (float fraction : c_fractions)
+        {
+            size_t count = size_t(float(order.size()) * fraction);
+            fprintf(file, "\"%s\",\"%zu\",\"%f\",\"%f\",\"%f\",", c_sourceNames[sourceIndex], order.size(), seconds * 1000.0, fraction, PointsLowFrequencyEnergy(order, count, width));
+            if (!originalOrder.empty())
+                fprintf(file, "\"%f\"\n", PointsLowFrequencyEnergy(originalOrder, count, width));
+            else
+                fprintf(file, "\"\"\n");
+        }
+    }
+    printf("\n");
+
+    fclose(file);
 }
 
 int main(int argc, char** argv)
 {
+    // compare the float FFT used for analysis to simple_fft
+    if (TEST_FFT())
+    {
+        printf("RealFFT2D vs simple_fft...\n");
+        TestFFT("out/fftSpeed.csv");
+    }
+
+    // check the FFT at sizes that aren't powers of two
+    if (TEST_FFT())
+    {
+        printf("RealFFT2D at non power of two sizes...\n");
+        TestFFTSizes("out/fftSizes.csv");
+    }
+
+    // see how the FFT scales with thread count
+    if (TEST_FFT_SCALING())
+    {
+        static size_t c_width = 4096;
+        printf("RealFFT2D thread scaling at %zux%zu...\n", c_width, c_width);
+        TestFFTScaling(c_width, "out/fftScaling.csv");
+    }
+
+    // compare the recursive gaussian blur to the direct gaussian blur
+    if (TEST_BLUR())
+    {
+        static size_t c_width = 256;
+        printf("Recursive vs direct gaussian blur...\n");
+        TestBlur(c_width, "out/blurRecursive.csv");
+    }
+
     // generate some white noise
     {
         static size_t c_width = 256;
@@ -85,10 +634,10 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("White noise");
-            MakeWhiteNoise(rng, noise, c_width);
+            MakeWhiteNoise(rng, noise, c_width, c_width);
         }
 
-        TestNoise(noise, c_width, "out/white");
+        TestNoise(noise, c_width, c_width, "out/white");
     }
 
     // generate blue noise by forced random sampling
@@ -96,13 +645,20 @@ int main(int argc, char** argv)
         static size_t c_width = 256;
 
         std::vector<uint8_t> noise;
+        std::vector<size_t> ranks;
 
         {
             ScopedTimer timer("Blue noise by using forced random sampling algorithm");
-            GenerateBN_FRS(noise, c_width, true);
+            MaskCacheKey cacheKey = MakeMaskCacheKey("frs", c_width, c_width, "blue");
+            if (!LoadCachedMask(cacheKey, noise, &ranks))
+            {
+                GenerateBN_FRS(noise, c_width, c_width, true, &ranks);
+                SaveCachedMask(cacheKey, noise, &ranks);
+            }
         }
 
-        TestNoise(noise, c_width, "out/blueFRS");
+        WriteRanks(ranks, c_width, c_width, "out/blueFRS");
+        TestNoise(noise, c_width, c_width, "out/blueFRS");
     }
 
     // generate red noise by forced random sampling
@@ -110,13 +666,20 @@ int main(int argc, char** argv)
         static size_t c_width = 256;
 
         std::vector<uint8_t> noise;
+        std::vector<size_t> ranks;
 
         {
             ScopedTimer timer("Red noise by using forced random sampling algorithm");
-            GenerateBN_FRS(noise, c_width, false);
+            MaskCacheKey cacheKey = MakeMaskCacheKey("frs", c_width, c_width, "red");
+            if (!LoadCachedMask(cacheKey, noise, &ranks))
+            {
+                GenerateBN_FRS(noise, c_width, c_width, false, &ranks);
+                SaveCachedMask(cacheKey, noise, &ranks);
+            }
         }
 
-        TestNoise(noise, c_width, "out/redFRS");
+        WriteRanks(ranks, c_width, c_width, "out/redFRS");
+        TestNoise(noise, c_width, c_width, "out/redFRS");
     }
 
     // generate blue noise by repeated high pass filtering white noise and fixing up the histogram
@@ -127,10 +690,15 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("Blue noise by high pass filtering white noise");
-            GenerateBN_HPF(noise, c_width);
+            MaskCacheKey cacheKey = MakeMaskCacheKey("hpf", c_width, c_width, "passes=5;sigma=1.0;red=0");
+            if (!LoadCachedMask(cacheKey, noise))
+            {
+                GenerateBN_HPF(noise, c_width, c_width);
+                SaveCachedMask(cacheKey, noise);
+            }
         }
 
-        TestNoise(noise, c_width, "out/blueHPF");
+        TestNoise(noise, c_width, c_width, "out/blueHPF");
     }
 
     // generate red noise by repeated low pass filtering white noise and fixing up the histogram
@@ -141,24 +709,56 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("Red noise by low pass filtering white noise");
-            GenerateBN_HPF(noise, c_width, 5, 1.0f, true);
+            MaskCacheKey cacheKey = MakeMaskCacheKey("hpf", c_width, c_width, "passes=5;sigma=1.0;red=1");
+            if (!LoadCachedMask(cacheKey, noise))
+            {
+                GenerateBN_HPF(noise, c_width, c_width, 5, 1.0f, true);
+                SaveCachedMask(cacheKey, noise);
+            }
         }
 
-        TestNoise(noise, c_width, "out/redLPF");
+        TestNoise(noise, c_width, c_width, "out/redLPF");
     }
 
-    // generate blue noise using void and cluster
+    // see how long void and cluster's initial binary pattern takes to converge
+    if (TEST_VOIDCLUSTER_INITIALBP_CONVERGENCE())
     {
-        static size_t c_width = 256;
+        printf("Void and cluster initial binary pattern convergence...\n");
+        TestInitialPatternConvergence("out/initialPatternConvergence.csv");
+    }
 
-        std::vector<uint8_t> noise;
+    // compare the initial binary patterns void and cluster can start from
+    if (TEST_VOIDCLUSTER_INITIAL_PATTERNS())
+    {
+        printf("Void and cluster initial patterns...\n");
+        TestInitialPatterns(128, "out/initialPatterns.csv");
+    }
+
+    // make the points of other generators progressive with void and cluster's phase 1
+    if (TEST_PROGRESSIVIZE())
+    {
+        printf("Progressivizing points...\n");
+        TestProgressivize(256, "bluenoise256.png", "out/progressivize.csv");
+    }
+
+    // generate blue noise using void and cluster. The mask is kept to compare the fixed point LUT's mask to, further down.
+    std::vector<uint8_t> voidClusterNoise;
+    std::vector<size_t> voidClusterRanks;
+    {
+        static size_t c_width = 256;
 
         {
             ScopedTimer timer("Blue noise by void and cluster");
-            GenerateBN_Void_Cluster(noise, c_width, false, "out/blueVC_1");
+            MaskCacheKey cacheKey = MakeMaskCacheKey("void_cluster", c_width, c_width, GetVoidClusterParams(VoidClusterInitialPattern::BinaryPattern).c_str());
+            if (!LoadCachedMask(cacheKey, voidClusterNoise, &voidClusterRanks))
+            {
+                GenerateBN_Void_Cluster(voidClusterNoise, c_width, c_width, VoidClusterInitialPattern::BinaryPattern, "out/blueVC_1", &voidClusterRanks);
+                SaveCachedMask(cacheKey, voidClusterNoise, &voidClusterRanks);
+            }
         }
 
-        TestNoise(noise, c_width, "out/blueVC_1");
+        WriteRanks(voidClusterRanks, c_width, c_width, "out/blueVC_1");
+        TestNoise(voidClusterNoise, c_width, c_width, "out/blueVC_1");
     }
 
     // generate blue noise using void and cluster but using mitchell's best candidate instead of initial binary pattern and phase 1
@@ -166,13 +766,106 @@ int main(int argc, char** argv)
         static size_t c_width = 256;
 
         std::vector<uint8_t> noise;
+        std::vector<size_t> ranks;
         
         {
             ScopedTimer timer("Blue noise by void and cluster with Mitchells best candidate");
-            GenerateBN_Void_Cluster(noise, c_width, true, "out/blueVC_1M");
+            MaskCacheKey cacheKey = MakeMaskCacheKey("void_cluster", c_width, c_width, GetVoidClusterParams(VoidClusterInitialPattern::MitchellsBestCandidate).c_str());
+            if (!LoadCachedMask(cacheKey, noise, &ranks))
+            {
+                GenerateBN_Void_Cluster(noise, c_width, c_width, VoidClusterInitialPattern::MitchellsBestCandidate, "out/blueVC_1M", &ranks);
+                SaveCachedMask(cacheKey, noise, &ranks);
+            }
+        }
+
+        WriteRanks(ranks, c_width, c_width, "out/blueVC_1M");
+        TestNoise(noise, c_width, c_width, "out/blueVC_1M");
+    }
+
+    // generate blue noise using void and cluster, starting from Poisson disk points instead of the initial binary pattern
+    {
+        static size_t c_width = 256;
+
+        std::vector<uint8_t> noise;
+        std::vector<size_t> ranks;
+
+        {
+            ScopedTimer timer("Blue noise by void and cluster with a Poisson disk initial pattern");
+            MaskCacheKey cacheKey = MakeMaskCacheKey("void_cluster", c_width, c_width, GetVoidClusterParams(VoidClusterInitialPattern::PoissonDisk).c_str());
+            if (!LoadCachedMask(cacheKey, noise, &ranks))
+            {
+                GenerateBN_Void_Cluster(noise, c_width, c_width, VoidClusterInitialPattern::PoissonDisk, "out/blueVC_1P", &ranks);
+                SaveCachedMask(cacheKey, noise, &ranks);
+            }
+        }
+
+        WriteRanks(ranks, c_width, c_width, "out/blueVC_1P");
+        TestNoise(noise, c_width, c_width, "out/blueVC_1P");
+    }
+
+    // generate blue noise using void and cluster, starting from capacity constrained Voronoi points
+    {
+        static size_t c_width = 256;
+
+        std::vector<uint8_t> noise;
+        std::vector<size_t> ranks;
+
+        {
+            ScopedTimer timer("Blue noise by void and cluster with a capacity constrained Voronoi initial pattern");
+            MaskCacheKey cacheKey = MakeMaskCacheKey("void_cluster", c_width, c_width, GetVoidClusterParams(VoidClusterInitialPattern::CapacityConstrainedVoronoi).c_str());
+            if (!LoadCachedMask(cacheKey, noise, &ranks))
+            {
+                GenerateBN_Void_Cluster(noise, c_width, c_width, VoidClusterInitialPattern::CapacityConstrainedVoronoi, "out/blueVC_1C", &ranks);
+                SaveCachedMask(cacheKey, noise, &ranks);
+            }
+        }
+
+        WriteRanks(ranks, c_width, c_width, "out/blueVC_1C");
+        TestNoise(noise, c_width, c_width, "out/blueVC_1C");
+    }
+
+    // generate blue noise using void and cluster with a fixed point LUT, and see how well its ranks agree with the float LUT's ranks
+    {
+        static size_t c_width = 256;
+
+        std::vector<uint8_t> noise;
+        std::vector<size_t> ranks;
+        const std::vector<uint8_t>& floatNoise = voidClusterNoise;
+        const std::vector<size_t>& floatRanks = voidClusterRanks;
+
+        {
+            ScopedTimer timer("Blue noise by void and cluster with a fixed point LUT");
+            MaskCacheKey cacheKey = MakeMaskCacheKey("void_cluster", c_width, c_width, GetVoidClusterParams(VoidClusterInitialPattern::BinaryPattern, VoidClusterLUT::FixedPoint32).c_str());
+            if (!LoadCachedMask(cacheKey, noise, &ranks))
+            {
+                GenerateBN_Void_Cluster(noise, c_width, c_width, VoidClusterInitialPattern::BinaryPattern, "out/blueVC_1F", &ranks, VoidClusterLUT::FixedPoint32);
+                SaveCachedMask(cacheKey, noise, &ranks);
+            }
         }
 
-        TestNoise(noise, c_width, "out/blueVC_1M");
+        // once one choice differs, the rest of the ranks can go a different way, so the U8 and rank differences are reported too
+        size_t sameRanks = 0;
+        size_t sameU8 = 0;
+        double sumRankDifference = 0.0;
+        for (size_t index = 0, count = ranks.size(); index < count; ++index)
+        {
+            if (ranks[index] == floatRanks[index])
+                sameRanks++;
+            if (noise[index] == floatNoise[index])
+                sameU8++;
+            sumRankDifference += std::abs(double(ranks[index]) - double(floatRanks[index]));
+        }
+        const double pixelCount = double(ranks.size());
+        printf("Fixed point vs float LUT: %0.2f%% same rank, %0.2f%% same U8 value, mean rank difference %0.2f\n\n",
+            100.0 * double(sameRanks) / pixelCount, 100.0 * double(sameU8) / pixelCount, sumRankDifference / pixelCount);
+
+        std::string csv;
+        AppendFormat(csv, "\"Same Rank %%\",\"Same U8 %%\",\"Mean Rank Difference\"\n");
+        AppendFormat(csv, "\"%f\",\"%f\",\"%f\"\n", 100.0 * double(sameRanks) / pixelCount, 100.0 * double(sameU8) / pixelCount, sumRankDifference / pixelCount);
+        GetOutputQueue().WriteText("out/blueVC_1F.agreement.csv", std::move(csv));
+
+        WriteRanks(ranks, c_width, c_width, "out/blueVC_1F");
+        TestNoise(noise, c_width, c_width, "out/blueVC_1F");
     }
 
     // load a blue noise texture
@@ -192,7 +885,7 @@ int main(int argc, char** argv)
             stbi_image_free(image);
         }
 
-        TestNoise(noise, width, "out/blueVC_2");
+        TestNoise(noise, width, height, "out/blueVC_2");
     }
 
     // generate blue noise by using paniq's first technique
@@ -204,10 +897,17 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("Blue noise by paniq");
-            GenerateBN_Paniq(noise, c_width, c_iterations, true);
+            char cacheParams[64];
+            sprintf(cacheParams, "iterations=%zu;blue=1", c_iterations);
+            MaskCacheKey cacheKey = MakeMaskCacheKey("paniq", c_width, c_width, cacheParams);
+            if (!LoadCachedMask(cacheKey, noise))
+            {
+                GenerateBN_Paniq(noise, c_width, c_width, c_iterations, true);
+                SaveCachedMask(cacheKey, noise);
+            }
         }
 
-        TestNoise(noise, c_width, "out/bluePaniq");
+        TestNoise(noise, c_width, c_width, "out/bluePaniq");
     }
 
     // generate red noise by using paniq's first technique
@@ -220,10 +920,30 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("Red noise by paniq");
-            GenerateBN_Paniq(noise, c_width, c_iterations, false);
+            char cacheParams[64];
+            sprintf(cacheParams, "iterations=%zu;blue=0", c_iterations);
+            MaskCacheKey cacheKey = MakeMaskCacheKey("paniq", c_width, c_width, cacheParams);
+            if (!LoadCachedMask(cacheKey, noise))
+            {
+                GenerateBN_Paniq(noise, c_width, c_width, c_iterations, false);
+                SaveCachedMask(cacheKey, noise);
+            }
         }
 
-        TestNoise(noise, c_width, "out/redPaniq");
+        TestNoise(noise, c_width, c_width, "out/redPaniq");
+    }
+
+    // measure paniq's first technique speed at a larger size. GenerateBN_Paniq reports the frames per second.
+    {
+        static size_t c_width = 1024;
+        static size_t c_iterations = 10;
+
+        std::vector<uint8_t> noise;
+
+        {
+            ScopedTimer timer("Blue noise by paniq 1024x1024");
+            GenerateBN_Paniq(noise, c_width, c_width, c_iterations, true);
+        }
     }
 
     // generate blue noise by using paniq's second technique
@@ -233,10 +953,23 @@ int main(int argc, char** argv)
         std::vector<uint8_t> noise;
         {
             ScopedTimer timer("Blue noise by paniq2");
-            GenerateBN_Paniq2(noise, c_width);
+            GenerateBN_Paniq2(noise, c_width, c_width);
         }
 
-        TestNoise(noise, c_width, "out/bluePaniq2");
+        TestNoise(noise, c_width, c_width, "out/bluePaniq2");
+    }
+
+    // generate blue noise by using paniq's second technique, on a morton curve instead of a hilbert curve
+    {
+        static size_t c_width = 256;
+
+        std::vector<uint8_t> noise;
+        {
+            ScopedTimer timer("Blue noise by paniq2 with morton curve");
+            GenerateBN_Paniq2(noise, c_width, c_width, Paniq2Curve::Morton);
+        }
+
+        TestNoise(noise, c_width, c_width, "out/bluePaniq2Morton");
     }
 
     // generate blue noise by swapping white noise pixels to make it more blue
@@ -248,10 +981,10 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("Blue noise by swapping white noise");
-            GenerateBN_Swap(noise, c_width, c_numSwaps, "out/blueSwap1.data.csv", true, 0.0f, 1, false, true);
+            GenerateBN_Swap(noise, c_width, c_width, c_numSwaps, "out/blueSwap1.data.csv", true, 0.0f, 1, false, true);
         }
 
-        TestNoise(noise, c_width, "out/blueSwap1");
+        TestNoise(noise, c_width, c_width, "out/blueSwap1");
     }
 
     // generate blue noise by swapping white noise pixels to make it more blue. 1-5 swaps
@@ -262,10 +995,10 @@ int main(int argc, char** argv)
         std::vector<uint8_t> noise;
         {
             ScopedTimer timer("Blue noise by swapping white noise. 1-5 swaps.");
-            GenerateBN_Swap(noise, c_width, c_numSwaps, "out/blueSwap5.data.csv", true, 0.0f, 5, false, true);
+            GenerateBN_Swap(noise, c_width, c_width, c_numSwaps, "out/blueSwap5.data.csv", true, 0.0f, 5, false, true);
         }
 
-        TestNoise(noise, c_width, "out/blueSwap5");
+        TestNoise(noise, c_width, c_width, "out/blueSwap5");
     }
 
     // generate blue noise by swapping white noise pixels to make it more blue. 1-10 swaps
@@ -277,10 +1010,10 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("Blue noise by swapping white noise. 1-10 swaps.");
-            GenerateBN_Swap(noise, c_width, c_numSwaps, "out/blueSwap10.data.csv", true, 0.0f, 10, false, true);
+            GenerateBN_Swap(noise, c_width, c_width, c_numSwaps, "out/blueSwap10.data.csv", true, 0.0f, 10, false, true);
         }
 
-        TestNoise(noise, c_width, "out/blueSwap10");
+        TestNoise(noise, c_width, c_width, "out/blueSwap10");
     }
 
     // generate red noise by swapping white noise pixels to make it more red. 1-10 swaps
@@ -292,10 +1025,10 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("Red noise by swapping white noise. 1-10 swaps.");
-            GenerateBN_Swap(noise, c_width, c_numSwaps, "out/redSwap10.data.csv", true, 0.0f, 10, false, false);
+            GenerateBN_Swap(noise, c_width, c_width, c_numSwaps, "out/redSwap10.data.csv", true, 0.0f, 10, false, false);
         }
 
-        TestNoise(noise, c_width, "out/redSwap10");
+        TestNoise(noise, c_width, c_width, "out/redSwap10");
     }
 
     // generate blue noise by swapping white noise pixels to make it more blue - with Simulated Annealing
@@ -307,10 +1040,10 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("Blue noise by swapping white noise - with SA");
-            GenerateBN_Swap(noise, c_width, c_numSwaps, "out/blueSwapSA.data.csv", true, 0.99f, 1, false, true);
+            GenerateBN_Swap(noise, c_width, c_width, c_numSwaps, "out/blueSwapSA.data.csv", true, 0.99f, 1, false, true);
         }
 
-        TestNoise(noise, c_width, "out/blueSwapSA");
+        TestNoise(noise, c_width, c_width, "out/blueSwapSA");
     }
 
     // generate blue noise by swapping white noise pixels to make it more blue - with metropolis algorithm and 1-10 swaps
@@ -322,12 +1055,81 @@ int main(int argc, char** argv)
 
         {
             ScopedTimer timer("Blue noise by swapping white noise - with metropolis and 1-10 swaps");
-            GenerateBN_Swap(noise, c_width, c_numSwaps, "out/blueSwapMet.data.csv", true, 1.0f, 10, false, true);
+            GenerateBN_Swap(noise, c_width, c_width, c_numSwaps, "out/blueSwapMet.data.csv", true, 1.0f, 10, false, true);
         }
 
-        TestNoise(noise, c_width, "out/blueSwapMet");
+        TestNoise(noise, c_width, c_width, "out/blueSwapMet");
     }
 
+    // generate a rectangular blue noise texture, at a non power of two size, by high pass filtering white noise
+    {
+        static size_t c_width = 480;
+        static size_t c_height = 270;
+
+        std::vector<uint8_t> noise;
+
+        {
+            ScopedTimer timer("Blue noise by high pass filtering white noise 480x270");
+            MaskCacheKey cacheKey = MakeMaskCacheKey("hpf", c_width, c_height, "passes=5;sigma=1.0;red=0");
+            if (!LoadCachedMask(cacheKey, noise))
+            {
+                GenerateBN_HPF(noise, c_width, c_height);
+                SaveCachedMask(cacheKey, noise);
+            }
+        }
+
+        TestNoise(noise, c_width, c_height, "out/blueHPF_480x270");
+    }
+
+    // generate a strip of blue noise using void and cluster, which tiles on both axes
+    {
+        static size_t c_width = 256;
+        static size_t c_height = 64;
+
+        std::vector<uint8_t> noise;
+        std::vector<size_t> ranks;
+
+        {
+            ScopedTimer timer("Blue noise by void and cluster 256x64");
+            MaskCacheKey cacheKey = MakeMaskCacheKey("void_cluster", c_width, c_height, GetVoidClusterParams(VoidClusterInitialPattern::BinaryPattern).c_str());
+            if (!LoadCachedMask(cacheKey, noise, &ranks))
+            {
+                GenerateBN_Void_Cluster(noise, c_width, c_height, VoidClusterInitialPattern::BinaryPattern, "out/blueVC_256x64", &ranks);
+                SaveCachedMask(cacheKey, noise, &ranks);
+            }
+        }
+
+        WriteRanks(ranks, c_width, c_height, "out/blueVC_256x64");
+        TestNoise(noise, c_width, c_height, "out/blueVC_256x64");
+    }
+
+    // a strip only a few pixels tall, where Mitchell's best candidate's point grid has many more cells across than down
+    {
+        static size_t c_width = 256;
+        static size_t c_height = 8;
+
+        std::vector<uint8_t> noise;
+        std::vector<size_t> ranks;
+
+        {
+            ScopedTimer timer("Blue noise by void and cluster with Mitchells best candidate 256x8");
+            MaskCacheKey cacheKey = MakeMaskCacheKey("void_cluster", c_width, c_height, GetVoidClusterParams(VoidClusterInitialPattern::MitchellsBestCandidate).c_str());
+            if (!LoadCachedMask(cacheKey, noise, &ranks))
+            {
+                GenerateBN_Void_Cluster(noise, c_width, c_height, VoidClusterInitialPattern::MitchellsBestCandidate, "out/blueVC_1M_256x8", &ranks);
+                SaveCachedMask(cacheKey, noise, &ranks);
+            }
+        }
+
+        WriteRanks(ranks, c_width, c_height, "out/blueVC_1M_256x8");
+        TestNoise(noise, c_width, c_height, "out/blueVC_1M_256x8");
+    }
+
+    // wait for all the files to be written
+    size_t outputFailures = GetOutputQueue().Flush();
+    if (outputFailures > 0)
+        printf("%zu output files could not be written\n", outputFailures);
+
     system("pause");
 
     return 0;
@@ -0,0 +1,124 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+bool MappedFile::Open(const char* fileName, size_t size)
+{
+    Close();
+
+    HANDLE file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    m_file = file;
+
+    LARGE_INTEGER fileSize;
+    fileSize.QuadPart = LONGLONG(size);
+    if (!SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+    {
+        Close();
+        return false;
+    }
+
+    m_size = size;
+    if (size == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, DWORD(uint64_t(size) >> 32), DWORD(size), nullptr);
+    if (!mapping)
+    {
+        Close();
+        return false;
+    }
+    m_mapping = mapping;
+
+    m_data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!m_data)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedFile::Flush()
+{
+    if (!m_data)
+        return true;
+    return FlushViewOfFile(m_data, 0) && FlushFileBuffers(HANDLE(m_file));
+}
+
+void MappedFile::Close()
+{
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(HANDLE(m_mapping));
+    if (m_file)
+        CloseHandle(HANDLE(m_file));
+    m_data = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static int GetFileDescriptor(void* file)
+{
+    return int(intptr_t(file)) - 1;
+}
+
+bool MappedFile::Open(const char* fileName, size_t size)
+{
+    Close();
+
+    int fileDescriptor = open(fileName, O_RDWR | O_CREAT, 0644);
+    if (fileDescriptor < 0)
+        return false;
+    m_file = (void*)intptr_t(fileDescriptor + 1);
+
+    if (ftruncate(fileDescriptor, off_t(size)) != 0)
+    {
+        Close();
+        return false;
+    }
+
+    m_size = size;
+    if (size == 0)
+        return true;
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    if (data == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+    m_data = data;
+    return true;
+}
+
+bool MappedFile::Flush()
+{
+    if (!m_data)
+        return true;
+    return msync(m_data, m_size, MS_SYNC) == 0;
+}
+
+void MappedFile::Close()
+{
+    if (m_data)
+        munmap(m_data, m_size);
+    if (m_file)
+        close(GetFileDescriptor(m_file));
+    m_data = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+}
+
+#endif
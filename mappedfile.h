@@ -0,0 +1,189 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <utility>
+
+// A file mapped into memory. The OS pages it in and out as it's used, so data much bigger than what should be resident can be
+// worked on, and what's in it is still on disk if the process stops.
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Opens or creates the file, sets its size, and maps all of it. What was in the file is kept, up to the new size.
+    // A size of 0 leaves the file empty and unmapped. Returns false on failure.
+    bool Open(const char* fileName, size_t size);
+
+    // writes changed pages to disk and waits for it to finish
+    bool Flush();
+
+    void Close();
+
+    void* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    void Swap(MappedFile& other)
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_file, other.m_file);
+        std::swap(m_mapping, other.m_mapping);
+    }
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+    void* m_file = nullptr;     // HANDLE on windows, file descriptor + 1 elsewhere, so nullptr means none
+    void* m_mapping = nullptr;  // HANDLE of the file mapping on windows
+};
+
+// The parts of std::vector that the generators use, kept in a memory mapped file.
+// SetFileName() has to be called before the size is set. Failing to map the file is fatal, like running out of memory would be.
+template <typename T>
+class MappedVector
+{
+public:
+    typedef T value_type;
+
+    MappedVector() {}
+    MappedVector(MappedVector&& other) { Swap(other); }
+    MappedVector& operator=(MappedVector&& other) { Swap(other); return *this; }
+
+    // copying copies the values into this vector's own file
+    MappedVector& operator=(const MappedVector& other)
+    {
+        Map(other.size());
+        if (other.size() > 0)
+            memcpy(data(), other.data(), other.size() * sizeof(T));
+        return *this;
+    }
+
+    void SetFileName(const std::string& fileName) { m_fileName = fileName; }
+    const std::string& GetFileName() const { return m_fileName; }
+
+    // maps count values from the file, keeping what was in it. Used to pick up where an earlier run left off.
+    void Map(size_t count)
+    {
+        if (!m_file.Open(m_fileName.c_str(), count * sizeof(T)))
+        {
+            printf("\nCould not map %zu bytes of %s\n", count * sizeof(T), m_fileName.c_str());
+            exit(1);
+        }
+        m_count = count;
+    }
+
+    // like std::vector, values past the old size are set to value
+    void resize(size_t count, const T& value = T())
+    {
+        size_t oldCount = m_count;
+        Map(count);
+        for (size_t index = oldCount; index < count; ++index)
+            data()[index] = value;
+    }
+
+    void clear() { Map(0); }
+    bool Flush() { return m_file.Flush(); }
+
+    // unmaps and deletes the file
+    void Remove()
+    {
+        m_file.Close();
+        m_count = 0;
+        remove(m_fileName.c_str());
+    }
+
+    void Swap(MappedVector& other)
+    {
+        m_file.Swap(other.m_file);
+        std::swap(m_count, other.m_count);
+        std::swap(m_fileName, other.m_fileName);
+    }
+
+    size_t size() const { return m_count; }
+    T* data() { return (T*)m_file.Data(); }
+    const T* data() const { return (const T*)m_file.Data(); }
+    T& operator[](size_t index) { return data()[index]; }
+    const T& operator[](size_t index) const { return data()[index]; }
+
+private:
+    MappedFile m_file;
+    size_t m_count = 0;
+    std::string m_fileName;
+};
+
+// std::vector<bool> in a memory mapped file
+class MappedBitVector
+{
+public:
+    class Reference
+    {
+    public:
+        Reference(uint64_t& word, uint64_t mask) : m_word(word), m_mask(mask) {}
+        operator bool() const { return (m_word & m_mask) != 0; }
+        Reference& operator=(bool value)
+        {
+            m_word = value ? (m_word | m_mask) : (m_word & ~m_mask);
+            return *this;
+        }
+        Reference& operator=(const Reference& other) { return *this = bool(other); }
+
+    private:
+        uint64_t& m_word;
+        uint64_t m_mask;
+    };
+
+    MappedBitVector() {}
+    MappedBitVector(MappedBitVector&& other) { Swap(other); }
+    MappedBitVector& operator=(MappedBitVector&& other) { Swap(other); return *this; }
+    MappedBitVector& operator=(const MappedBitVector& other)
+    {
+        m_words = other.m_words;
+        m_count = other.m_count;
+        return *this;
+    }
+
+    void SetFileName(const std::string& fileName) { m_words.SetFileName(fileName); }
+
+    void Map(size_t count)
+    {
+        m_words.Map((count + 63) / 64);
+        m_count = count;
+    }
+
+    void resize(size_t count, bool value = false)
+    {
+        size_t oldCount = m_count;
+        m_words.resize((count + 63) / 64, 0);
+        m_count = count;
+        for (size_t index = oldCount; index < count; ++index)
+            (*this)[index] = value;
+    }
+
+    void clear() { m_words.clear(); m_count = 0; }
+    bool Flush() { return m_words.Flush(); }
+    void Remove() { m_words.Remove(); m_count = 0; }
+
+    void Swap(MappedBitVector& other)
+    {
+        m_words.Swap(other.m_words);
+        std::swap(m_count, other.m_count);
+    }
+
+    void swap(MappedBitVector& other) { Swap(other); }
+
+    size_t size() const { return m_count; }
+    Reference operator[](size_t index) { return Reference(m_words[index / 64], uint64_t(1) << (index % 64)); }
+    bool operator[](size_t index) const { return (m_words[index / 64] & (uint64_t(1) << (index % 64))) != 0; }
+
+private:
+    MappedVector<uint64_t> m_words;
+    size_t m_count = 0;
+};
@@ -0,0 +1,161 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "maskcache.h"
+#include "misc.h"
+#include "output.h"
+#include "settings.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char c_maskCacheMagic[4] = { 'B', 'N', 'M', 'C' };
+
+// FNV-1a
+static uint64_t HashString(const std::string& text)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : text)
+    {
+        hash ^= uint8_t(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static void GetEntryFileName(const MaskCacheKey& key, const char* extension, char fileName[256])
+{
+    sprintf(fileName, "%s/%016llx.%s", MASK_CACHE_DIRECTORY(), (unsigned long long)key.hash, extension);
+}
+
+static void AppendBytes(std::vector<uint8_t>& bytes, const void* data, size_t size)
+{
+    const uint8_t* begin = (const uint8_t*)data;
+    bytes.insert(bytes.end(), begin, begin + size);
+}
+
+MaskCacheKey MakeMaskCacheKey(const char* generator, size_t width, size_t height, const char* params)
+{
+    MaskCacheKey key;
+    key.generator = generator;
+    key.width = width;
+    key.height = height;
+    key.params = params;
+
+    // the height is only in the description of rectangles, so square masks keep the entries they had before rectangles were supported
+    AppendFormat(key.description, "generator=%s;width=%zu;", generator, width);
+    if (height != width)
+        AppendFormat(key.description, "height=%zu;", height);
+    AppendFormat(key.description, "params=%s;seed=", params);
+    static const unsigned c_seed[] = { DETERMINISTIC_SEED() };
+    for (size_t index = 0; index < sizeof(c_seed) / sizeof(c_seed[0]); ++index)
+        AppendFormat(key.description, "%s%u", index > 0 ? "," : "", c_seed[index]);
+    AppendFormat(key.description, ";version=%i", MASK_CACHE_VERSION());
+
+    key.hash = HashString(key.description);
+    return key;
+}
+
+bool LoadCachedMask(const MaskCacheKey& key, std::vector<uint8_t>& noise, std::vector<size_t>* ranks)
+{
+    if (!MASK_CACHE() || !DETERMINISTIC())
+        return false;
+
+    if (MASK_CACHE_INVALIDATE())
+    {
+        InvalidateCachedMask(key);
+        return false;
+    }
+
+    char fileName[256];
+    GetEntryFileName(key, "mask", fileName);
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "rb");
+    if (!file)
+        return false;
+
+    // magic, description length, description, pixel count, whether there are ranks, U8 mask, uint32 ranks
+    bool hit = false;
+    char magic[4];
+    uint32_t descriptionLength = 0;
+    if (fread(magic, 1, 4, file) == 4 && memcmp(magic, c_maskCacheMagic, 4) == 0 &&
+        fread(&descriptionLength, sizeof(descriptionLength), 1, file) == 1 && descriptionLength == key.description.size())
+    {
+        std::string description(descriptionLength, ' ');
+        uint64_t pixelCount = 0;
+        uint8_t hasRanks = 0;
+        if (fread(&description[0], 1, descriptionLength, file) == descriptionLength && description == key.description &&
+            fread(&pixelCount, sizeof(pixelCount), 1, file) == 1 && pixelCount == uint64_t(key.width) * uint64_t(key.height) &&
+            fread(&hasRanks, sizeof(hasRanks), 1, file) == 1 && (hasRanks || !ranks))
+        {
+            noise.resize(size_t(pixelCount));
+            hit = fread(noise.data(), 1, noise.size(), file) == noise.size();
+
+            if (hit && ranks)
+            {
+                std::vector<uint32_t> storedRanks(noise.size());
+                hit = fread(storedRanks.data(), sizeof(uint32_t), storedRanks.size(), file) == storedRanks.size();
+                ranks->assign(storedRanks.begin(), storedRanks.end());
+            }
+        }
+    }
+    fclose(file);
+
+    if (hit)
+        printf("Loaded %s %zux%zu from mask cache %s\n", key.generator.c_str(), key.width, key.height, fileName);
+    return hit;
+}
+
+void SaveCachedMask(const MaskCacheKey& key, const std::vector<uint8_t>& noise, const std::vector<size_t>* ranks)
+{
+    if (!MASK_CACHE() || !DETERMINISTIC())
+        return;
+
+    MakeDirectory(MASK_CACHE_DIRECTORY());
+
+    std::vector<uint8_t> bytes;
+    uint32_t descriptionLength = uint32_t(key.description.size());
+    uint64_t pixelCount = noise.size();
+    uint8_t hasRanks = ranks ? 1 : 0;
+    AppendBytes(bytes, c_maskCacheMagic, 4);
+    AppendBytes(bytes, &descriptionLength, sizeof(descriptionLength));
+    AppendBytes(bytes, key.description.data(), key.description.size());
+    AppendBytes(bytes, &pixelCount, sizeof(pixelCount));
+    AppendBytes(bytes, &hasRanks, sizeof(hasRanks));
+    AppendBytes(bytes, noise.data(), noise.size());
+    if (ranks)
+    {
+        for (size_t rank : *ranks)
+        {
+            uint32_t storedRank = uint32_t(rank);
+            AppendBytes(bytes, &storedRank, sizeof(storedRank));
+        }
+    }
+
+    char fileName[256];
+    GetEntryFileName(key, "mask", fileName);
+    GetOutputQueue().WriteBinary(fileName, std::move(bytes));
+
+    // the manifest is for people and tools looking in the cache. Loading only uses the .mask file.
+    std::string json;
+    AppendFormat(json, "{\n");
+    AppendFormat(json, "  \"generator\": \"%s\",\n", key.generator.c_str());
+    AppendFormat(json, "  \"width\": %zu,\n", key.width);
+    AppendFormat(json, "  \"height\": %zu,\n", key.height);
+    AppendFormat(json, "  \"params\": \"%s\",\n", key.params.c_str());
+    AppendFormat(json, "  \"version\": %i,\n", MASK_CACHE_VERSION());
+    AppendFormat(json, "  \"hasRanks\": %s,\n", ranks ? "true" : "false");
+    AppendFormat(json, "  \"description\": \"%s\"\n", key.description.c_str());
+    AppendFormat(json, "}\n");
+
+    GetEntryFileName(key, "json", fileName);
+    GetOutputQueue().WriteText(fileName, std::move(json));
+}
+
+void InvalidateCachedMask(const MaskCacheKey& key)
+{
+    char fileName[256];
+    GetEntryFileName(key, "mask", fileName);
+    remove(fileName);
+    GetEntryFileName(key, "json", fileName);
+    remove(fileName);
+}
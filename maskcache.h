@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// An on disk cache of generated masks, so that repeat runs don't regenerate them.
+// Masks are keyed by a hash of the generator name, size, a string of the generator's parameters, the seed and MASK_CACHE_VERSION().
+// The cache is only used when DETERMINISTIC() is on, since otherwise every run is meant to give a different mask.
+// Each entry is <hash>.mask holding the U8 mask and the ranks if the generator makes them, and <hash>.json describing what it is.
+struct MaskCacheKey
+{
+    std::string generator;
+    size_t width;
+    size_t height;
+    std::string params;
+    std::string description; // everything that went into the hash. Stored in the entry and checked on load, so hash collisions are misses.
+    uint64_t hash;
+};
+
+MaskCacheKey MakeMaskCacheKey(const char* generator, size_t width, size_t height, const char* params);
+
+// Returns true and fills in noise, and ranks if it isn't null, if the mask is in the cache.
+// A hit needs the ranks to be in the entry if they were asked for. If MASK_CACHE_INVALIDATE() is on, the entry is deleted and it's a miss.
+bool LoadCachedMask(const MaskCacheKey& key, std::vector<uint8_t>& noise, std::vector<size_t>* ranks = nullptr);
+
+// writes the mask, and the ranks if not null, to the cache through the output queue
+void SaveCachedMask(const MaskCacheKey& key, const std::vector<uint8_t>& noise, const std::vector<size_t>* ranks = nullptr);
+
+// deletes the entry for this key, if there is one
+void InvalidateCachedMask(const MaskCacheKey& key);
@@ -1,5 +1,11 @@
 #pragma once
 
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 template <typename T>
 T Clamp(T min, T max, T value)
 {
@@ -14,4 +20,14 @@ T Clamp(T min, T max, T value)
 inline float Lerp(float a, float b, float t)
 {
     return a * (1.0f - t) + b * t;
+}
+
+// makes a directory. It's fine if it is already there.
+inline void MakeDirectory(const char* path)
+{
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0777);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,280 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "output.h"
+#include "settings.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "stb/stb_image_write.h"
+
+// stb_image_write has this but doesn't declare it in the header
+extern "C" unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+
+static uint32_t CRC32(const uint8_t* data, size_t length, uint32_t crc = 0)
+{
+    crc = ~crc;
+    for (size_t index = 0; index < length; ++index)
+    {
+        crc ^= data[index];
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+static void AppendBigEndian32(std::vector<uint8_t>& bytes, uint32_t value)
+{
+    bytes.push_back(uint8_t(value >> 24));
+    bytes.push_back(uint8_t(value >> 16));
+    bytes.push_back(uint8_t(value >> 8));
+    bytes.push_back(uint8_t(value));
+}
+
+static void AppendPNGChunk(std::vector<uint8_t>& png, const char* type, const uint8_t* data, size_t length)
+{
+    AppendBigEndian32(png, uint32_t(length));
+    size_t typeStart = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data, data + length);
+    AppendBigEndian32(png, CRC32(&png[typeStart], length + 4));
+}
+
+// stb_image_write only does 8 bit PNGs, so 16 bit greyscale ones are put together here, using stb's zlib compressor.
+// PNG stores 16 bit samples big endian, and every row starts with a filter type byte, which is 0 (none) here.
+static bool WritePNG16File(const char* fileName, size_t width, size_t height, const std::vector<uint16_t>& pixels)
+{
+    std::vector<uint8_t> rows(height * (width * 2 + 1));
+    for (size_t y = 0; y < height; ++y)
+    {
+        uint8_t* row = &rows[y * (width * 2 + 1)];
+        row[0] = 0;
+        for (size_t x = 0; x < width; ++x)
+        {
+            row[1 + x * 2 + 0] = uint8_t(pixels[y * width + x] >> 8);
+            row[1 + x * 2 + 1] = uint8_t(pixels[y * width + x]);
+        }
+    }
+
+    int compressedLength = 0;
+    unsigned char* compressed = stbi_zlib_compress(rows.data(), int(rows.size()), &compressedLength, stbi_write_png_compression_level);
+    if (!compressed)
+        return false;
+
+    std::vector<uint8_t> header;
+    AppendBigEndian32(header, uint32_t(width));
+    AppendBigEndian32(header, uint32_t(height));
+    header.push_back(16); // bit depth
+    header.push_back(0); // color type: greyscale
+    header.push_back(0); // compression method
+    header.push_back(0); // filter method
+    header.push_back(0); // no interlacing
+
+    static const uint8_t c_signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    std::vector<uint8_t> png(c_signature, c_signature + sizeof(c_signature));
+    AppendPNGChunk(png, "IHDR", header.data(), header.size());
+    AppendPNGChunk(png, "IDAT", compressed, size_t(compressedLength));
+    AppendPNGChunk(png, "IEND", nullptr, 0);
+    free(compressed);
+
+    FILE* file = nullptr;
+    fopen_s(&file, fileName, "wb");
+    if (!file)
+        return false;
+    bool success = fwrite(png.data(), 1, png.size(), file) == png.size();
+    return (fclose(file) == 0) && success;
+}
+
+OutputQueue::OutputQueue(size_t threadCount, size_t maxQueuedJobs, int pngCompressionLevel)
+    : m_maxQueuedJobs(maxQueuedJobs > 0 ? maxQueuedJobs : 1)
+{
+    stbi_write_png_compression_level = pngCompressionLevel;
+
+    if (threadCount == 0)
+        threadCount = 1;
+    for (size_t index = 0; index < threadCount; ++index)
+        m_threads.push_back(std::thread(&OutputQueue::WorkerThread, this));
+}
+
+OutputQueue::~OutputQueue()
+{
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exit = true;
+    }
+    m_jobAdded.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+void OutputQueue::WritePNG(const char* fileName, size_t width, size_t height, int channels, std::vector<uint8_t>&& pixels)
+{
+    Job job;
+    job.type = JobType::PNG;
+    job.fileName = fileName;
+    job.width = width;
+    job.height = height;
+    job.channels = channels;
+    job.pixels = std::move(pixels);
+    AddJob(std::move(job));
+}
+
+void OutputQueue::WritePNG(const char* fileName, Image<uint8_t>&& image)
+{
+    Job job;
+    job.type = JobType::ImagePNG;
+    job.fileName = fileName;
+    job.width = image.m_width;
+    job.height = image.m_height;
+    job.channels = 1;
+    job.image = std::move(image);
+    AddJob(std::move(job));
+}
+
+void OutputQueue::WritePNG16(const char* fileName, size_t width, size_t height, std::vector<uint16_t>&& pixels)
+{
+    Job job;
+    job.type = JobType::PNG16;
+    job.fileName = fileName;
+    job.width = width;
+    job.height = height;
+    job.channels = 1;
+    job.pixels16 = std::move(pixels);
+    AddJob(std::move(job));
+}
+
+void OutputQueue::WriteText(const char* fileName, std::string&& text)
+{
+    Job job;
+    job.type = JobType::Text;
+    job.fileName = fileName;
+    job.width = 0;
+    job.height = 0;
+    job.channels = 0;
+    job.text = std::move(text);
+    AddJob(std::move(job));
+}
+
+void OutputQueue::WriteBinary(const char* fileName, std::vector<uint8_t>&& bytes)
+{
+    Job job;
+    job.type = JobType::Binary;
+    job.fileName = fileName;
+    job.width = 0;
+    job.height = 0;
+    job.channels = 0;
+    job.pixels = std::move(bytes);
+    AddJob(std::move(job));
+}
+
+void OutputQueue::AddJob(Job&& job)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobTaken.wait(lock, [this] { return m_jobs.size() < m_maxQueuedJobs; });
+        m_jobs.push_back(std::move(job));
+    }
+    m_jobAdded.notify_one();
+}
+
+size_t OutputQueue::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobsDone.wait(lock, [this] { return m_jobs.empty() && m_jobsInProgress == 0; });
+    size_t failures = m_failures;
+    m_failures = 0;
+    return failures;
+}
+
+void OutputQueue::WorkerThread()
+{
+    while (1)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAdded.wait(lock, [this] { return m_exit || !m_jobs.empty(); });
+            if (m_jobs.empty())
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_jobsInProgress++;
+        }
+        m_jobTaken.notify_one();
+
+        bool success = false;
+        switch (job.type)
+        {
+            case JobType::PNG:
+            {
+                success = stbi_write_png(job.fileName.c_str(), int(job.width), int(job.height), job.channels, job.pixels.data(), 0) != 0;
+                break;
+            }
+            case JobType::ImagePNG:
+            {
+                success = stbi_write_png(job.fileName.c_str(), int(job.width), int(job.height), 1, job.image.pixels.data(), int(job.image.m_stride)) != 0;
+                break;
+            }
+            case JobType::PNG16:
+            {
+                success = WritePNG16File(job.fileName.c_str(), job.width, job.height, job.pixels16);
+                break;
+            }
+            case JobType::Text:
+            case JobType::Binary:
+            {
+                const bool isText = job.type == JobType::Text;
+                const void* data = isText ? (const void*)job.text.data() : (const void*)job.pixels.data();
+                const size_t size = isText ? job.text.size() : job.pixels.size();
+
+                FILE* file = nullptr;
+                fopen_s(&file, job.fileName.c_str(), isText ? "w+t" : "wb");
+                if (file)
+                {
+                    success = fwrite(data, 1, size, file) == size;
+                    success = (fclose(file) == 0) && success;
+                }
+                break;
+            }
+        }
+
+        if (!success)
+            printf("\nCould not write %s\n", job.fileName.c_str());
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobsInProgress--;
+            if (!success)
+                m_failures++;
+        }
+        m_jobsDone.notify_all();
+    }
+}
+
+OutputQueue& GetOutputQueue()
+{
+    static OutputQueue s_outputQueue(OUTPUT_THREADS(), OUTPUT_MAX_QUEUED_FILES(), OUTPUT_PNG_COMPRESSION_LEVEL());
+    return s_outputQueue;
+}
+
+void AppendFormat(std::string& text, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    int length = vsnprintf(nullptr, 0, format, args);
+    va_end(args);
+
+    if (length > 0)
+    {
+        size_t oldSize = text.size();
+        text.resize(oldSize + size_t(length) + 1);
+        vsnprintf(&text[oldSize], size_t(length) + 1, format, argsCopy);
+        text.resize(oldSize + size_t(length));
+    }
+    va_end(argsCopy);
+}
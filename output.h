@@ -0,0 +1,75 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "image.h"
+
+// Writes files on background threads so that generation and analysis don't wait on PNG compression and disk.
+// The pixels and text are moved into the queue, so there are no copies.
+// The queue is bounded, so when it is full, adding a file waits for a worker to take one, which keeps memory use in check.
+class OutputQueue
+{
+public:
+    // pngCompressionLevel is the zlib level from 0 to 9. stb_image_write only has a global for this, so it applies to all PNGs.
+    OutputQueue(size_t threadCount, size_t maxQueuedJobs, int pngCompressionLevel);
+    ~OutputQueue(); // flushes
+
+    void WritePNG(const char* fileName, size_t width, size_t height, int channels, std::vector<uint8_t>&& pixels);
+    void WritePNG(const char* fileName, Image<uint8_t>&& image); // single channel, written straight from the padded rows
+    void WritePNG16(const char* fileName, size_t width, size_t height, std::vector<uint16_t>&& pixels); // single channel
+    void WriteText(const char* fileName, std::string&& text);
+    void WriteBinary(const char* fileName, std::vector<uint8_t>&& bytes);
+
+    // waits until everything queued so far has been written.
+    // Returns the number of files that failed to write since the last flush. The failures are also printed as they happen.
+    size_t Flush();
+
+private:
+    enum class JobType
+    {
+        PNG,
+        ImagePNG,
+        PNG16,
+        Text,
+        Binary
+    };
+
+    struct Job
+    {
+        JobType type;
+        std::string fileName;
+        size_t width;
+        size_t height;
+        int channels;
+        std::vector<uint8_t> pixels; // also the bytes of binary files
+        std::vector<uint16_t> pixels16;
+        Image<uint8_t> image;
+        std::string text;
+    };
+
+    void AddJob(Job&& job);
+    void WorkerThread();
+
+    size_t m_maxQueuedJobs;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAdded;
+    std::condition_variable m_jobTaken;
+    std::condition_variable m_jobsDone;
+    std::deque<Job> m_jobs;
+    size_t m_jobsInProgress = 0;
+    size_t m_failures = 0;
+    bool m_exit = false;
+    std::vector<std::thread> m_threads;
+};
+
+// the output queue shared by everything, made with the settings in settings.h
+OutputQueue& GetOutputQueue();
+
+// printf onto the end of a string, for building up text files to give to the output queue
+void AppendFormat(std::string& text, const char* format, ...);
@@ -0,0 +1,60 @@
+#include "processmemory.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+
+#include <windows.h>
+#include <psapi.h>
+
+#pragma comment(lib, "psapi.lib")
+
+size_t GetCurrentMemoryUsage()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.WorkingSetSize;
+}
+
+size_t GetPeakMemoryUsage()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PeakWorkingSetSize;
+}
+
+#else
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+size_t GetCurrentMemoryUsage()
+{
+    // the second number in statm is the resident set size in pages
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file)
+        return 0;
+    unsigned long long pages = 0;
+    unsigned long long residentPages = 0;
+    bool success = fscanf(file, "%llu %llu", &pages, &residentPages) == 2;
+    fclose(file);
+    return success ? size_t(residentPages) * size_t(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+size_t GetPeakMemoryUsage()
+{
+    // ru_maxrss is in kilobytes
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return size_t(usage.ru_maxrss) * 1024;
+}
+
+#endif
+
+void PrintMemoryUsage(const char* label)
+{
+    printf("%s: %0.1f MB, peak %0.1f MB\n", label, double(GetCurrentMemoryUsage()) / (1024.0 * 1024.0), double(GetPeakMemoryUsage()) / (1024.0 * 1024.0));
+}
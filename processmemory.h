@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+
+// The memory this process is using (working set / resident set size), and the most it has used so far, in bytes.
+// The peak never goes down, so the peak after a phase of an algorithm is the peak of that phase or an earlier one.
+size_t GetCurrentMemoryUsage();
+size_t GetPeakMemoryUsage();
+
+// prints the current and peak memory usage in MB, after the label
+void PrintMemoryUsage(const char* label);
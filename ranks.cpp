@@ -0,0 +1,134 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "ranks.h"
+#include "output.h"
+#include "settings.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void QuantizeRanks(const std::vector<size_t>& ranks, std::vector<float>& values)
+{
+    const double count = double(ranks.size());
+    values.resize(ranks.size());
+    for (size_t index = 0; index < ranks.size(); ++index)
+        values[index] = float(double(ranks[index]) / count);
+}
+
+static void AppendLittleEndian(std::vector<uint8_t>& bytes, uint64_t value, size_t byteCount)
+{
+    for (size_t index = 0; index < byteCount; ++index)
+        bytes.push_back(uint8_t(value >> (index * 8)));
+}
+
+static size_t BytesPerValue(RankFileType type)
+{
+    return (type == RankFileType::U16) ? 2 : 4;
+}
+
+// the values are appended little endian, regardless of the machine
+static void AppendRankValues(std::vector<uint8_t>& bytes, const std::vector<size_t>& ranks, RankFileType type)
+{
+    bytes.reserve(bytes.size() + ranks.size() * BytesPerValue(type));
+    switch (type)
+    {
+        case RankFileType::U16:
+        {
+            std::vector<uint16_t> values;
+            QuantizeRanks(ranks, values);
+            for (uint16_t value : values)
+                AppendLittleEndian(bytes, value, 2);
+            break;
+        }
+        case RankFileType::U32:
+        {
+            for (size_t rank : ranks)
+                AppendLittleEndian(bytes, uint32_t(rank), 4);
+            break;
+        }
+        case RankFileType::F32:
+        {
+            std::vector<float> values;
+            QuantizeRanks(ranks, values);
+            for (float value : values)
+            {
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                AppendLittleEndian(bytes, bits, 4);
+            }
+            break;
+        }
+    }
+}
+
+void WriteRanksRaw(const char* fileName, const std::vector<size_t>& ranks, size_t width, size_t height, RankFileType type)
+{
+    static const char* c_typeCodes[] = { "u16 ", "u32 ", "f32 " };
+
+    std::vector<uint8_t> bytes;
+    bytes.push_back('B');
+    bytes.push_back('N');
+    bytes.push_back('R');
+    bytes.push_back('K');
+    AppendLittleEndian(bytes, width, 4);
+    AppendLittleEndian(bytes, height, 4);
+    bytes.insert(bytes.end(), c_typeCodes[int(type)], c_typeCodes[int(type)] + 4);
+    AppendRankValues(bytes, ranks, type);
+    GetOutputQueue().WriteBinary(fileName, std::move(bytes));
+}
+
+void WriteRanksNPY(const char* fileName, const std::vector<size_t>& ranks, size_t width, size_t height, RankFileType type)
+{
+    static const char* c_descriptions[] = { "<u2", "<u4", "<f4" };
+
+    char header[256];
+    sprintf(header, "{'descr': '%s', 'fortran_order': False, 'shape': (%zu, %zu), }", c_descriptions[int(type)], height, width);
+
+    // magic string, version 1.0, header length, then the header padded with spaces and ending in a newline, to a multiple of 64 bytes
+    std::vector<uint8_t> bytes;
+    static const uint8_t c_magic[] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0 };
+    bytes.insert(bytes.end(), c_magic, c_magic + sizeof(c_magic));
+
+    size_t headerLength = strlen(header) + 1;
+    size_t paddedLength = ((sizeof(c_magic) + 2 + headerLength + 63) / 64) * 64 - sizeof(c_magic) - 2;
+    AppendLittleEndian(bytes, paddedLength, 2);
+    bytes.insert(bytes.end(), header, header + strlen(header));
+    bytes.resize(sizeof(c_magic) + 2 + paddedLength - 1, ' ');
+    bytes.push_back('\n');
+
+    AppendRankValues(bytes, ranks, type);
+    GetOutputQueue().WriteBinary(fileName, std::move(bytes));
+}
+
+void WriteRanksPNG16(const char* fileName, const std::vector<size_t>& ranks, size_t width, size_t height)
+{
+    std::vector<uint16_t> values;
+    QuantizeRanks(ranks, values);
+    GetOutputQueue().WritePNG16(fileName, width, height, std::move(values));
+}
+
+void WriteRanks(const std::vector<size_t>& ranks, size_t width, size_t height, const char* baseFileName)
+{
+    static const char* c_typeNames[] = { "u16", "u32", "f32" };
+    const RankFileType type = RANKS_FILE_TYPE();
+
+    char fileName[256];
+
+    if (SAVE_RANKS_PNG16())
+    {
+        sprintf(fileName, "%s.16.png", baseFileName);
+        WriteRanksPNG16(fileName, ranks, width, height);
+    }
+
+    if (SAVE_RANKS_RAW())
+    {
+        sprintf(fileName, "%s.%s.raw", baseFileName, c_typeNames[int(type)]);
+        WriteRanksRaw(fileName, ranks, width, height, type);
+    }
+
+    if (SAVE_RANKS_NPY())
+    {
+        sprintf(fileName, "%s.%s.npy", baseFileName, c_typeNames[int(type)]);
+        WriteRanksNPY(fileName, ranks, width, height, type);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <limits>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+
+// Generators like void and cluster and forced random sampling give every pixel a rank from 0 to N-1, where N is the pixel count.
+// Those ranks can be quantized to any bit depth, or saved at full precision so that one generation serves every bit depth.
+
+// value = rank * 2^bits / N, which is the same as the 8 bit conversion the generators have always done.
+// The ranks can be any unsigned integer type, in any container with size() and [], so generators can keep them as uint32 to save memory,
+// or in a memory mapped file.
+template <typename TRANKS, typename T>
+void QuantizeRanks(const TRANKS& ranks, std::vector<T>& values)
+{
+    static_assert(std::is_integral<T>::value, "the float version of QuantizeRanks takes size_t ranks");
+
+    const uint64_t count = ranks.size();
+    const uint64_t levels = uint64_t(std::numeric_limits<T>::max()) + 1;
+    values.resize(ranks.size());
+    for (size_t index = 0; index < ranks.size(); ++index)
+        values[index] = T(uint64_t(ranks[index]) * levels / count);
+}
+
+// value = rank / N, in [0,1)
+void QuantizeRanks(const std::vector<size_t>& ranks, std::vector<float>& values);
+
+enum class RankFileType
+{
+    U16, // QuantizeRanks to 16 bits
+    U32, // the ranks themselves
+    F32  // QuantizeRanks to float
+};
+
+// Raw files are a 16 byte header followed by the values, little endian, in row major order.
+// The header is the 4 characters "BNRK", then uint32 width, uint32 height, and 4 characters for the type of the values:
+// "u16 " for uint16, "u32 " for uint32 and "f32 " for float. The data starts 16 bytes in, so it can be memory mapped and used in place.
+void WriteRanksRaw(const char* fileName, const std::vector<size_t>& ranks, size_t width, size_t height, RankFileType type);
+
+// NumPy .npy version 1.0 files, with the header padded to 64 bytes so the data is aligned for memory mapping (numpy.load(mmap_mode='r')).
+void WriteRanksNPY(const char* fileName, const std::vector<size_t>& ranks, size_t width, size_t height, RankFileType type);
+
+// single channel 16 bit PNG
+void WriteRanksPNG16(const char* fileName, const std::vector<size_t>& ranks, size_t width, size_t height);
+
+// writes the formats turned on in settings.h: <base>.16.png, <base>.<type>.raw and <base>.<type>.npy
+void WriteRanks(const std::vector<size_t>& ranks, size_t width, size_t height, const char* baseFileName);
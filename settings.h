@@ -7,5 +7,49 @@
 
 #define THRESHOLD_SAMPLES() 11 // the number of samples for threshold testing.
 
+#define SPECTRUM_LOW_FREQUENCY_CUTOFF() 0.25f // frequencies below this fraction of nyquist count as low frequency in the spectral metrics.
+
+#define TEST_FFT() false // if true, main compares the FFT used for analysis to simple_fft and to a reference DFT, into out/fftSpeed.csv and out/fftSizes.csv
+#define TEST_FFT_SCALING() false // if true, main times 4096x4096 FFTs at 1 to 32 threads, into out/fftScaling.csv
+#define TEST_BLUR() false // if true, main compares the recursive gaussian blur to the direct one for accuracy and speed, into out/blurRecursive.csv
+
 #define SAVE_VOIDCLUSTER_INITIALBP() false
-#define SAVE_VOIDCLUSTER_PHASE1() false
\ No newline at end of file
+#define SAVE_VOIDCLUSTER_PHASE1() false
+
+#define PANIQ_SIMD() true // if true, paniq's first technique uses SSE2 to process 8 pixels at a time. Gives identical results to the scalar code.
+
+#define OUTPUT_THREADS() 2 // the number of background threads writing output files.
+#define OUTPUT_MAX_QUEUED_FILES() 64 // adding more output files than this waits for the writer threads to catch up.
+#define OUTPUT_PNG_COMPRESSION_LEVEL() 8 // zlib level from 0 to 9 for PNGs. 8 is the stb default. Lower is a little faster but makes bigger files.
+
+#define SAVE_RANKS_PNG16() true // full precision rank outputs of generators that make ranks, like void and cluster and FRS
+#define SAVE_RANKS_RAW() true
+#define SAVE_RANKS_NPY() true
+#define RANKS_FILE_TYPE() RankFileType::U32 // the type in the raw and npy rank files. U32 is lossless for up to 2^32 pixels.
+
+#define MASK_CACHE() true // if true, generated masks are saved to and loaded from an on disk cache. Only used when DETERMINISTIC() is true.
+#define MASK_CACHE_DIRECTORY() "cache"
+#define MASK_CACHE_INVALIDATE() false // if true, cached masks are deleted and made again
+#define MASK_CACHE_VERSION() 2 // change this when a generator gives different results, so old cache entries are not used. 2 is for void and cluster's initial random points, which could land one past the end before.
+
+#define VOIDCLUSTER_MEMORY_LEAN() false // if true, void and cluster remakes the initial pattern and LUT for phase 2 instead of keeping copies. Same results, less memory, a little slower.
+#define VOIDCLUSTER_BACKING_STORE() false // if true, void and cluster keeps its LUT, patterns and ranks in memory mapped files instead of in memory, so masks bigger than RAM can be made. Implies memory lean. The files are remade every run, so CHECKPOINT() is needed to resume a stopped run.
+#define VOIDCLUSTER_BACKING_STORE_DIRECTORY() "vcstate" // where the memory mapped files go. They are deleted when the mask is done.
+
+#define CHECKPOINT() false // if true, void and cluster, swap and paniq save their state every so often, and continue from it when run again after being stopped. Results are the same as an uninterrupted run.
+#define CHECKPOINT_INTERVAL_SECONDS() 60
+#define CHECKPOINT_RESUME() true // if false, existing checkpoints are ignored, and overwritten by new ones
+#define CHECKPOINT_DIRECTORY() "checkpoints"
+
+#define VOIDCLUSTER_INITIALBP_MAX_ITERATIONS_PER_POINT() 4 // the initial binary pattern stops after this many iterations per 1 in it, even if it isn't stable. It is usually stable after about 0.35. 0 is no limit.
+#define VOIDCLUSTER_INITIALBP_CYCLE_WINDOW() 256 // how many recent patterns the initial binary pattern remembers the hashes of, to find when it comes back to one and is going around in a cycle. 0 is no cycle detection.
+#define TEST_VOIDCLUSTER_INITIALBP_CONVERGENCE() false // if true, main times how long the initial binary pattern takes to converge at sizes from 16 to 256, into out/initialPatternConvergence.csv
+
+#define VOIDCLUSTER_CCVD_ITERATIONS() 50 // how many iterations the capacity constrained voronoi initial binary pattern does
+#define TEST_VOIDCLUSTER_INITIAL_PATTERNS() false // if true, main makes a 128x128 void and cluster mask from each initial pattern and compares them, into out/initialPatterns.csv
+
+#define VOIDCLUSTER_THRESHOLD_DENSITY() 0.1f // the fraction of pixels the thresholded paniq and HPF initial patterns keep
+#define VOIDCLUSTER_THRESHOLD_PANIQ_ITERATIONS() 120 // how many iterations paniq runs for the thresholded paniq initial pattern
+#define VOIDCLUSTER_THRESHOLD_REFINE_ITERATIONS_PER_POINT() 0.1f // how much the thresholded initial patterns are refined by moving points from clusters to voids. 0 is no refinement.
+
+#define TEST_PROGRESSIVIZE() false // if true, main makes the points of a few generators progressive with void and cluster's phase 1, into out/progressivize.csv
\ No newline at end of file
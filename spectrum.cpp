@@ -0,0 +1,198 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "spectrum.h"
+#include "fft2d.h"
+#include "output.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+// Gathers the power of frequencies into radius bins, and calculates the metrics from them.
+// The frequencies of a rectangle are scaled so that the bins are the size of the shorter side's bins.
+struct SpectralMetricsAccumulator
+{
+    SpectralMetricsAccumulator(size_t width, size_t height, float lowFrequencyCutoff)
+        : m_radiusCount(std::min(width, height) / 2 + 1)
+        , m_scaleX(float(std::min(width, height)) / float(width))
+        , m_scaleY(float(std::min(width, height)) / float(height))
+        , m_lowFrequencyCutoff(lowFrequencyCutoff)
+        , m_lowFrequencyRadius(lowFrequencyCutoff * float(std::min(width, height) / 2))
+        , m_sums(m_radiusCount, 0.0)
+        , m_sumsSquared(m_radiusCount, 0.0)
+        , m_counts(m_radiusCount, 0)
+    {
+    }
+
+    // fx and fy are signed frequencies. count is how many frequencies this stands for.
+    void Add(float fx, float fy, double value, size_t count)
+    {
+        if (fx == 0.0f && fy == 0.0f)
+            return;
+
+        fx *= m_scaleX;
+        fy *= m_scaleY;
+        float radius = sqrtf(fx*fx + fy * fy);
+
+        m_totalPower += value * double(count);
+        if (radius < m_lowFrequencyRadius)
+            m_lowFrequencyPower += value * double(count);
+
+        size_t bin = size_t(radius + 0.5f);
+        if (bin >= m_radiusCount)
+            return;
+
+        m_sums[bin] += value * double(count);
+        m_sumsSquared[bin] += value * value * double(count);
+        m_counts[bin] += count;
+    }
+
+    void Finish(SpectralMetrics& metrics)
+    {
+        metrics.radialPower.resize(m_radiusCount);
+        metrics.anisotropy.resize(m_radiusCount);
+        for (size_t bin = 0; bin < m_radiusCount; ++bin)
+        {
+            if (m_counts[bin] == 0)
+            {
+                metrics.radialPower[bin] = 0.0f;
+                metrics.anisotropy[bin] = 0.0f;
+                continue;
+            }
+
+            double mean = m_sums[bin] / double(m_counts[bin]);
+            double variance = m_sumsSquared[bin] / double(m_counts[bin]) - mean * mean;
+            if (variance < 0.0)
+                variance = 0.0;
+
+            metrics.radialPower[bin] = float(mean);
+            metrics.anisotropy[bin] = (mean > 0.0) ? float(variance / (mean * mean)) : 0.0f;
+        }
+
+        metrics.lowFrequencyCutoff = m_lowFrequencyCutoff;
+        metrics.lowFrequencyEnergy = (m_totalPower > 0.0) ? float(m_lowFrequencyPower / m_totalPower) : 0.0f;
+    }
+
+    size_t m_radiusCount;
+    float m_scaleX;
+    float m_scaleY;
+    float m_lowFrequencyCutoff;
+    float m_lowFrequencyRadius;
+    std::vector<double> m_sums;
+    std::vector<double> m_sumsSquared;
+    std::vector<size_t> m_counts;
+    double m_totalPower = 0.0;
+    double m_lowFrequencyPower = 0.0;
+};
+
+// frequencies past the middle are negative frequencies
+static inline float SignedFrequency(size_t index, size_t size)
+{
+    return (index <= size / 2) ? float(index) : float(index) - float(size);
+}
+
+void CalculateSpectralMetrics(const std::vector<float>& power, size_t width, size_t height, float lowFrequencyCutoff, SpectralMetrics& metrics)
+{
+    SpectralMetricsAccumulator accumulator(width, height, lowFrequencyCutoff);
+    for (size_t y = 0; y < height; ++y)
+    {
+        float fy = SignedFrequency(y, height);
+        for (size_t x = 0; x < width; ++x)
+            accumulator.Add(SignedFrequency(x, width), fy, power[y*width + x], 1);
+    }
+    accumulator.Finish(metrics);
+}
+
+// Same as CalculateSpectralMetrics, but from the half spectrum that RealFFT2D makes. The columns between the first and last
+// stand for themselves and their mirror image, which has the same power and radius, so they are counted twice.
+// When the width is odd, the last column has a mirror image too.
+static void CalculateSpectralMetricsHalf(const AlignedVector<ComplexFloat>& spectrum, size_t width, size_t height, float lowFrequencyCutoff, SpectralMetrics& metrics)
+{
+    const float normalization = 1.0f / float(width * height);
+
+    SpectralMetricsAccumulator accumulator(width, height, lowFrequencyCutoff);
+    for (size_t x = 0; x <= width / 2; ++x)
+    {
+        size_t count = (x == 0 || (x * 2 == width)) ? 1 : 2;
+        float fx = float(x);
+        for (size_t y = 0; y < height; ++y)
+        {
+            const ComplexFloat& c = spectrum[x * height + y];
+            accumulator.Add(fx, SignedFrequency(y, height), (c.real() * c.real() + c.imag() * c.imag()) * normalization, count);
+        }
+    }
+    accumulator.Finish(metrics);
+}
+
+void CalculateThresholdSpectralMetrics(const std::vector<uint8_t>& noise, size_t width, size_t height, float lowFrequencyCutoff, std::vector<SpectralMetrics>& metrics)
+{
+    const size_t pixelCount = width * height;
+
+    // put the pixels in order of value, so each level's flipped pixels are next to each other
+    std::vector<size_t> valueStarts(257, 0);
+    for (uint8_t value : noise)
+        valueStarts[value + 1]++;
+    for (size_t value = 1; value < 257; ++value)
+        valueStarts[value] += valueStarts[value - 1];
+    std::vector<uint32_t> pixelsByValue(pixelCount);
+    {
+        std::vector<size_t> offsets(valueStarts.begin(), valueStarts.end() - 1);
+        for (size_t index = 0; index < pixelCount; ++index)
+            pixelsByValue[offsets[noise[index]]++] = uint32_t(index);
+    }
+
+    // start at threshold 0
+    std::vector<float> binaryImage(pixelCount);
+    for (size_t index = 0; index < pixelCount; ++index)
+        binaryImage[index] = noise[index] > 0 ? 1.0f : 0.0f;
+
+    AlignedVector<ComplexFloat> spectrum;
+
+    metrics.resize(255);
+    for (size_t threshold = 0; threshold < 255; ++threshold)
+    {
+        // a pixel is white if its value is greater than the threshold, so going up to this threshold turns off the pixels with a value of threshold
+        if (threshold > 0)
+        {
+            for (size_t flip = valueStarts[threshold]; flip < valueStarts[threshold + 1]; ++flip)
+                binaryImage[pixelsByValue[flip]] = 0.0f;
+        }
+
+        // a level with no white pixels has no power at all
+        if (valueStarts[threshold + 1] == pixelCount)
+        {
+            SpectralMetricsAccumulator(width, height, lowFrequencyCutoff).Finish(metrics[threshold]);
+            continue;
+        }
+
+        RealFFT2D(binaryImage.data(), width, height, spectrum);
+        CalculateSpectralMetricsHalf(spectrum, width, height, lowFrequencyCutoff, metrics[threshold]);
+    }
+}
+
+void WriteSpectralMetrics(const SpectralMetrics& metrics, const char* csvFileName, const char* jsonFileName)
+{
+    std::string csv;
+    AppendFormat(csv, "\"Radius\",\"Power\",\"Anisotropy\"\n");
+    for (size_t index = 0, count = metrics.radialPower.size(); index < count; ++index)
+        AppendFormat(csv, "\"%zu\",\"%f\",\"%f\"\n", index, metrics.radialPower[index], metrics.anisotropy[index]);
+    GetOutputQueue().WriteText(csvFileName, std::move(csv));
+
+    std::string json;
+    AppendFormat(json, "{\n");
+    AppendFormat(json, "  \"lowFrequencyCutoff\": %f,\n", metrics.lowFrequencyCutoff);
+    AppendFormat(json, "  \"lowFrequencyEnergy\": %f,\n", metrics.lowFrequencyEnergy);
+
+    AppendFormat(json, "  \"radialPower\": [");
+    for (size_t index = 0, count = metrics.radialPower.size(); index < count; ++index)
+        AppendFormat(json, "%s%f", index > 0 ? ", " : "", metrics.radialPower[index]);
+    AppendFormat(json, "],\n");
+
+    AppendFormat(json, "  \"anisotropy\": [");
+    for (size_t index = 0, count = metrics.anisotropy.size(); index < count; ++index)
+        AppendFormat(json, "%s%f", index > 0 ? ", " : "", metrics.anisotropy[index]);
+    AppendFormat(json, "]\n");
+
+    AppendFormat(json, "}\n");
+    GetOutputQueue().WriteText(jsonFileName, std::move(json));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Numeric quality metrics of an image's power spectrum.
+// Radii are in frequency bins, from 0 (DC) to width/2 (nyquist). Frequencies farther out than nyquist (the corners) aren't included.
+// For rectangles, the bins are the size of the shorter side's bins, and nyquist is that side's nyquist.
+struct SpectralMetrics
+{
+    // mean power of the frequencies at each radius
+    std::vector<float> radialPower;
+
+    // variance of the power at each radius divided by the squared mean power. 0 means the spectrum is perfectly radially symmetric.
+    // from "Digital Halftoning" by Robert Ulichney
+    std::vector<float> anisotropy;
+
+    // the fraction of the total power (not counting DC) that is at a radius below the cutoff
+    float lowFrequencyEnergy = 0.0f;
+    float lowFrequencyCutoff = 0.0f; // as a fraction of nyquist
+};
+
+// power is |F|^2 of a width x height image, in the normal FFT layout with DC at (0,0)
+void CalculateSpectralMetrics(const std::vector<float>& power, size_t width, size_t height, float lowFrequencyCutoff, SpectralMetrics& metrics);
+
+// Calculates the metrics of a U8 mask thresholded at every level from 0 to 254, where a pixel is white if its value is greater than the threshold.
+// Each level is an FFT, and the metrics are read straight from the half spectrum it makes. Going up one level only turns off the pixels
+// with that value, so the binary image is updated in place from the pixels sorted by value. Levels with no white pixels have all 0 metrics.
+void CalculateThresholdSpectralMetrics(const std::vector<uint8_t>& noise, size_t width, size_t height, float lowFrequencyCutoff, std::vector<SpectralMetrics>& metrics);
+
+// writes the per radius metrics to a csv file, and everything to a json file, through the output queue
+void WriteSpectralMetrics(const SpectralMetrics& metrics, const char* csvFileName, const char* jsonFileName);
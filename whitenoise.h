@@ -30,15 +30,15 @@ inline uint8_t RandomValue<uint8_t>(std::mt19937& rng)
 }
 
 template <typename T>
-inline void MakeWhiteNoise(std::mt19937& rng, std::vector<T>& pixels, size_t width)
+inline void MakeWhiteNoise(std::mt19937& rng, std::vector<T>& pixels, size_t width, size_t height)
 {
-    pixels.resize(width*width);
+    pixels.resize(width*height);
 
     // NOTE: this works, but won't give a balanced histogram
     //for (T& pixel : pixels)
         //pixel = RandomValue<T>();
 
-    for (size_t index = 0, count = width * width; index < count; ++index)
+    for (size_t index = 0, count = width * height; index < count; ++index)
     {
         float percent = float(index) / float(count - 1);
         float value = Lerp(0, float(std::numeric_limits<T>::max() + 1), percent); // intentionally not using convert.h conversion. this is subtly different.
@@ -49,12 +49,23 @@ inline void MakeWhiteNoise(std::mt19937& rng, std::vector<T>& pixels, size_t wid
     std::shuffle(pixels.begin(), pixels.end(), rng);
 }
 
-inline void MakeWhiteNoiseFloat(std::mt19937& rng, std::vector<float>& pixels, size_t width)
+template <typename T>
+inline void MakeWhiteNoise(std::mt19937& rng, std::vector<T>& pixels, size_t width)
 {
-    pixels.resize(width*width);
+    MakeWhiteNoise(rng, pixels, width, width);
+}
 
-    for (size_t index = 0, count = width * width; index < count; ++index)
+inline void MakeWhiteNoiseFloat(std::mt19937& rng, std::vector<float>& pixels, size_t width, size_t height)
+{
+    pixels.resize(width*height);
+
+    for (size_t index = 0, count = width * height; index < count; ++index)
         pixels[index] = float(index) / float(count - 1);
 
     std::shuffle(pixels.begin(), pixels.end(), rng);
+}
+
+inline void MakeWhiteNoiseFloat(std::mt19937& rng, std::vector<float>& pixels, size_t width)
+{
+    MakeWhiteNoiseFloat(rng, pixels, width, width);
 }
\ No newline at end of file